@@ -1,26 +1,24 @@
 #version 430 core
 
+// CAMERA_UNIFORM_BUFFER_BINDING is defined by the engine when the shader is loaded
+
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec2 worldPosition;
 layout(location = 2) in vec2 scale;
 layout(location = 3) in vec4 in_color;
 
-layout(location = 0) uniform mat4 projection;
-layout(location = 1) uniform mat4 view;
+layout(std140, binding = CAMERA_UNIFORM_BUFFER_BINDING) uniform Camera
+{
+	mat4 viewProjection;
+	vec2 viewPosition;
+	vec2 viewSize;
+};
 
 out vec4 color;
 
 void main()
 {
-	mat4 world = mat4(
-		scale.x,			0,					0,				0,
-		0,					scale.y,			0,				0,
-		0,					0,					1,				0,
-		worldPosition.x,	worldPosition.y,	0,				1
-	);
-
-	vec4 finalPosition = projection * view * world * vec4(position, 0.0f, 1.0f);
-	gl_Position = finalPosition;
+	gl_Position = viewProjection * vec4(worldPosition + position * scale, 0.0f, 1.0f);
 
 	color = in_color;
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 430 core
+
+// CAMERA_UNIFORM_BUFFER_BINDING is defined by the engine when the shader is loaded
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 uv;
+layout(location = 2) in vec2 particlePosition;
+layout(location = 3) in vec2 particleUVOffset;
+layout(location = 4) in float particleSize;
+
+layout(location = 6) uniform vec2 uvOffsetScaleFactor; // The same for every particle drawn from a texture
+
+layout(std140, binding = CAMERA_UNIFORM_BUFFER_BINDING) uniform Camera
+{
+	mat4 viewProjection;
+	vec2 viewPosition;
+	vec2 viewSize;
+};
+
+out vec2 out_uv;
+
+void main()
+{
+	vec2 worldPosition = particlePosition + position * particleSize;
+
+	gl_Position = viewProjection * vec4(worldPosition, 0.0f, 1.0f);
+
+	out_uv = (uv + particleUVOffset) / uvOffsetScaleFactor;
+}
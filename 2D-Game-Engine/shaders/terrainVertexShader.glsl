@@ -1,31 +1,81 @@
 #version 430 core
 
-#define BLOCK_SIZE 16
-#define MAX_ANIMATION_LENGTH 30
+// BLOCK_SIZE, CHUNK_SIZE, MAX_ANIMATION_LENGTH and CAMERA_UNIFORM_BUFFER_BINDING are defined by the engine when the shader is loaded
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in vec2 uv;
-layout(location = 2) in vec2 worldPosition;
-layout(location = 3) in uint uvOffsetIndex;
+struct Material
+{
+	vec2 uvOffsetScaleFactor;
+	uint frameCount;
+	float frameRate;
+	vec2 uvOffsets[MAX_ANIMATION_LENGTH];
+};
+
+layout(location = 0) in uvec2 blockData; // The block type and uv offset index, one per block in block order
 
-layout(location = 0) uniform mat4 projection;
-layout(location = 1) uniform mat4 view;
-layout(location = 4) uniform vec2 uvOffsetScaleFactor;
-layout(location = 6) uniform vec2 uvOffsets[MAX_ANIMATION_LENGTH];
+layout(location = 6) uniform int lodLevel; // Each tile covers 2^lodLevel blocks in each direction
+layout(location = 7) uniform float time; // Seconds, used to animate blocks
+
+layout(std140, binding = CAMERA_UNIFORM_BUFFER_BINDING) uniform Camera
+{
+	mat4 viewProjection;
+	vec2 viewPosition;
+	vec2 viewSize;
+};
+
+layout(std430, binding = 0) readonly buffer MaterialTable
+{
+	Material materials[];
+};
+
+// The origin of each chunk container's chunk relative to the floating origin
+layout(std430, binding = 1) readonly buffer ChunkOrigins
+{
+	vec2 chunkOrigins[];
+};
 
 out vec2 out_uv;
 
 void main()
 {
-	mat4 world = mat4(
-		BLOCK_SIZE,			0,					0,				0,
-		0,					BLOCK_SIZE,			0,				0,
-		0,					0,					BLOCK_SIZE,		0,
-		worldPosition.x,	worldPosition.y,	0,				1
-	);
-
-	vec4 finalPosition = projection * view * world * vec4(position, 0.0f, 1.0f);
-	gl_Position = finalPosition;
-
-	out_uv = (uv + uvOffsets[uvOffsetIndex]) / uvOffsetScaleFactor;
-}
\ No newline at end of file
+	// The quad's corner comes from the low bits of the vertex ID, and the chunk container from the base vertex
+	int corner = gl_VertexID & 3;
+	int containerIndex = gl_VertexID >> 2;
+
+	uint blockType = blockData.x;
+	uint uvOffsetIndex = blockData.y;
+
+	// Air (block type 0) collapses to a degenerate quad so nothing is rasterized
+	if (blockType == 0u)
+	{
+		gl_Position = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		out_uv = vec2(0.0f);
+		return;
+	}
+
+	vec2 uv = vec2(corner & 1, corner >> 1);
+	vec2 position = uv - vec2(0.5f);
+
+	// The instance index is the tile's index in the chunk, which gives its position relative to the chunk's origin.
+	// At full detail a tile is a single block.
+	int tileSize = 1 << lodLevel;
+	int tilesWide = CHUNK_SIZE >> lodLevel;
+	float tileWorldSize = float(BLOCK_SIZE * tileSize);
+
+	vec2 tilePosition = (vec2(gl_InstanceID % tilesWide, gl_InstanceID / tilesWide) * tileSize + vec2((tileSize - 1) * 0.5f)) * BLOCK_SIZE;
+	vec2 worldPosition = chunkOrigins[containerIndex] + tilePosition + position * tileWorldSize;
+
+	gl_Position = viewProjection * vec4(worldPosition, 0.0f, 1.0f);
+
+	Material material = materials[blockType];
+
+	// Animated blocks step through their frames from their uv offset index. Each block starts at a different point
+	// in the animation, hashed from its position in the chunk, so neighbouring blocks don't animate in lockstep.
+	if (material.frameCount > 1u)
+	{
+		uint phase = (uint(gl_InstanceID) * 2654435761u) >> 16;
+		uint frame = uint(time * material.frameRate) + phase;
+		uvOffsetIndex = (uvOffsetIndex + frame) % material.frameCount;
+	}
+
+	out_uv = (uv + material.uvOffsets[uvOffsetIndex]) / material.uvOffsetScaleFactor;
+}
@@ -0,0 +1,17 @@
+#version 430 core
+
+in vec2 out_uv;
+in vec4 color;
+
+layout(location = 3) uniform sampler2D tex;
+
+out vec4 out_color;
+
+void main()
+{
+	// Blending is off, so the space around each glyph is cut out instead
+	if (texture2D(tex, out_uv).a < 0.5f)
+		discard;
+
+	out_color = color;
+}
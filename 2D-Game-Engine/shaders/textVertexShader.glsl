@@ -0,0 +1,28 @@
+#version 430 core
+
+// GLYPH_ATLAS_COLUMNS and GLYPH_ATLAS_ROWS are defined by the engine when the shader is loaded
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 uv;
+layout(location = 2) in vec4 instanceTransform; // Top left corner and size in pixels
+layout(location = 3) in vec4 instanceColor;
+layout(location = 4) in uint instanceGlyph;
+
+layout(location = 6) uniform vec2 screenSize;
+
+out vec2 out_uv;
+out vec4 color;
+
+void main()
+{
+	// Screen coordinates start in the top left corner and go down
+	vec2 screenPosition = instanceTransform.xy + (position + 0.5f) * instanceTransform.zw;
+	vec2 clipPosition = screenPosition / screenSize * 2.0f - 1.0f;
+
+	gl_Position = vec4(clipPosition.x, -clipPosition.y, 0.0f, 1.0f);
+
+	vec2 cell = vec2(instanceGlyph % GLYPH_ATLAS_COLUMNS, instanceGlyph / GLYPH_ATLAS_COLUMNS);
+	out_uv = (cell + uv) / vec2(GLYPH_ATLAS_COLUMNS, GLYPH_ATLAS_ROWS);
+
+	color = instanceColor;
+}
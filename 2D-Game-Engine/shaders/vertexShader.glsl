@@ -1,20 +1,26 @@
 #version 430 core
 
+// CAMERA_UNIFORM_BUFFER_BINDING is defined by the engine when the shader is loaded
+
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec2 uv;
+layout(location = 2) in vec4 instanceTransform; // Position and size
+layout(location = 3) in vec4 instanceUV; // Uv offset and uv offset scale factor
 
-layout(location = 0) uniform mat4 projection;
-layout(location = 1) uniform mat4 view;
-layout(location = 2) uniform mat4 world;
-layout(location = 4) uniform vec2 uvOffsetScaleFactor;
-layout(location = 6) uniform vec2 uvOffset;
+layout(std140, binding = CAMERA_UNIFORM_BUFFER_BINDING) uniform Camera
+{
+	mat4 viewProjection;
+	vec2 viewPosition;
+	vec2 viewSize;
+};
 
 out vec2 out_uv;
 
 void main()
 {
-	vec4 finalPosition = projection * view * world * vec4(position, 0.0f, 1.0f);
-	gl_Position = finalPosition;
+	vec2 worldPosition = instanceTransform.xy + position * instanceTransform.zw;
+
+	gl_Position = viewProjection * vec4(worldPosition, 0.0f, 1.0f);
 
-	out_uv = (uv + uvOffset) / uvOffsetScaleFactor;
-}
\ No newline at end of file
+	out_uv = (uv + instanceUV.xy) / instanceUV.zw;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#define ASSET_ID_FNV_OFFSET_BASIS 2166136261u // The 32 bit FNV-1a starting hash
+#define ASSET_ID_FNV_PRIME 16777619u // The 32 bit FNV-1a multiplier
+
+// An asset's name hashed with FNV-1a, so assets are found by the contents of their name rather than the address of the string
+typedef uint32_t AssetID;
+
+constexpr AssetID hashAssetName(const char* name)
+{
+	AssetID hash = ASSET_ID_FNV_OFFSET_BASIS;
+	for (; *name; name++)
+	{
+		hash = (hash ^ (unsigned char)*name) * ASSET_ID_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+// Hashes a name known at compile time, which is guaranteed not to be hashed at runtime
+#define ASSET_ID(name) (std::integral_constant<AssetID, hashAssetName(name)>::value)
+
+#define ASSET_HANDLE_INVALID 0xFFFFFFFFu // The index of a handle to an asset that isn't loaded, which resolves to an empty texture or shader program 0
+
+// Indices into the asset manager's tables, which are found once and then resolve an asset without hashing.
+// They're separate types so a texture handle can't be used to look up a shader.
+struct TextureHandle
+{
+	unsigned int index;
+};
+
+struct ShaderHandle
+{
+	unsigned int index;
+};
@@ -1,13 +1,41 @@
 #include "stdafx.h"
 #include "AssetManager.h"
 
-#include <GL/glew.h>
+#include "GraphicsDevice.h"
+#include "UploadRingBuffer.h"
+
 #include <FreeImage.h>
 
 #include <fstream>
 
 AssetManager* AssetManager::m_instance = nullptr;
 
+// Loads an image converted to 32 bits, since every atlas page is BGRA. Safe to call from any thread.
+static FIBITMAP* loadImage(const char* filepath)
+{
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(filepath, 0);
+	if (fif == FIF_UNKNOWN)
+	{
+		fif = FreeImage_GetFIFFromFilename(filepath);
+
+		if (fif == FIF_UNKNOWN)
+			return nullptr;
+	}
+
+	//check that the plugin has reading capabilities and load the file
+	FIBITMAP* dib = nullptr;
+	if (FreeImage_FIFSupportsReading(fif))
+		dib = FreeImage_Load(fif, filepath);
+
+	if (!dib)
+		return nullptr;
+
+	FIBITMAP* dib32 = FreeImage_ConvertTo32Bits(dib);
+	FreeImage_Unload(dib);
+
+	return dib32;
+}
+
 AssetManager::AssetManager()
 {
 	if (!m_instance)
@@ -17,27 +45,57 @@ AssetManager::AssetManager()
 		Output::error("Attempted to create a second AssetManager instance - this is not supported. Use AssetManager::getInstance() instead.");
 		exit(EXIT_FAILURE);
 	}
+
+	m_textureAtlas = new TextureAtlas();
+	m_uploadBuffer = new UploadRingBuffer();
 }
 
 AssetManager::~AssetManager()
 {
-	for (auto it = m_textureMap.begin(); it != m_textureMap.end(); it++)
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	// Deleting a pending asset waits for its worker thread. Anything still pending was either never uploaded,
+	// or was uploaded into an atlas page, which the atlas deletes, so only compiled programs need deleting.
+	for (size_t i = 0; i < m_pendingTextures.size(); i++)
+	{
+		delete m_pendingTextures[i];
+	}
+	m_pendingTextures.clear();
+
+	for (size_t i = 0; i < m_pendingShaders.size(); i++)
 	{
-		glDeleteTextures(1, &it->second);
+		if (m_pendingShaders[i]->program)
+			device->deleteProgram(m_pendingShaders[i]->program);
+
+		delete m_pendingShaders[i];
 	}
-	m_textureMap.clear();
+	m_pendingShaders.clear();
+
+	delete m_uploadBuffer;
+
+	// Textures in the atlas share its pages, which it deletes itself
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].padding == 0.0f)
+			device->deleteTexture(m_textures[i].id);
+	}
+	m_textures.clear();
+	m_textureIndices.clear();
+
+	delete m_textureAtlas;
 
 	for (auto it = m_shaderMap.begin(); it != m_shaderMap.end(); it++)
 	{
-		glDeleteShader(it->second);
+		device->deleteShader(it->second);
 	}
 	m_shaderMap.clear();
 
-	for (auto it = m_shaderProgramMap.begin(); it != m_shaderProgramMap.end(); it++)
+	for (size_t i = 0; i < m_shaderPrograms.size(); i++)
 	{
-		glDeleteProgram(it->second);
+		device->deleteProgram(m_shaderPrograms[i]);
 	}
-	m_shaderProgramMap.clear();
+	m_shaderPrograms.clear();
+	m_shaderProgramIndices.clear();
 
 	m_instance = nullptr;
 }
@@ -47,70 +105,118 @@ AssetManager* AssetManager::getInstance()
 	return m_instance;
 }
 
-unsigned int AssetManager::getTexture(const char* name)
+Texture AssetManager::getTexture(AssetID id) const
 {
-	assert(m_textureMap.find(name) != m_textureMap.end());
-	return m_textureMap[name];
+	return getTexture(getTextureHandle(id));
 }
 
-unsigned int AssetManager::getShader(const char* name)
+unsigned int AssetManager::getShader(AssetID id) const
 {
-	assert(m_shaderProgramMap.find(name) != m_shaderProgramMap.end());
-	return m_shaderProgramMap[name];
+	return getShader(getShaderHandle(id));
 }
 
-unsigned int AssetManager::loadTexture(const char* name, const char* filepath)
+TextureHandle AssetManager::getTextureHandle(AssetID id) const
 {
-	assert(m_textureMap.find(name) == m_textureMap.end());
+	TextureHandle handle;
+	handle.index = ASSET_HANDLE_INVALID;
 
-	FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
-	FIBITMAP* dib = nullptr;
-	unsigned char* textureData;
-	unsigned int width, height;
+	auto it = m_textureIndices.find(id);
+	if (it != m_textureIndices.end())
+		handle.index = it->second;
+	else
+		Output::error("ERROR: Tried to get texture " + std::to_string(id) + " but it hasn't been loaded.");
 
-	fif = FreeImage_GetFileType(filepath, 0);
-	if (fif == FIF_UNKNOWN)
-	{
-		fif = FreeImage_GetFIFFromFilename(filepath);
+	return handle;
+}
 
-		if (fif == FIF_UNKNOWN)
-			return 0;
-	}
+ShaderHandle AssetManager::getShaderHandle(AssetID id) const
+{
+	ShaderHandle handle;
+	handle.index = ASSET_HANDLE_INVALID;
 
-	//check that the plugin has reading capabilities and load the file
-	if (FreeImage_FIFSupportsReading(fif))
-		dib = FreeImage_Load(fif, filepath);
+	auto it = m_shaderProgramIndices.find(id);
+	if (it != m_shaderProgramIndices.end())
+		handle.index = it->second;
+	else
+		Output::error("ERROR: Tried to get shader " + std::to_string(id) + " but it hasn't been loaded.");
+
+	return handle;
+}
+
+const Texture& AssetManager::getTexture(TextureHandle handle) const
+{
+	// Covers ASSET_HANDLE_INVALID, which is past the end of any table
+	if (handle.index >= m_textures.size()) return m_emptyTexture;
 
+	return m_textures[handle.index];
+}
+
+unsigned int AssetManager::getShader(ShaderHandle handle) const
+{
+	if (handle.index >= m_shaderPrograms.size()) return 0;
+
+	return m_shaderPrograms[handle.index];
+}
+
+bool AssetManager::isTextureLoaded(AssetID id) const
+{
+	return m_textureIndices.find(id) != m_textureIndices.end();
+}
+
+bool AssetManager::isShaderLoaded(AssetID id) const
+{
+	return m_shaderProgramIndices.find(id) != m_shaderProgramIndices.end();
+}
+
+size_t AssetManager::getPendingAssetCount() const
+{
+	return m_pendingTextures.size() + m_pendingShaders.size();
+}
+
+void AssetManager::update()
+{
+	updatePendingTextures();
+	updatePendingShaders();
+}
+
+Texture AssetManager::loadTexture(const char* name, const char* filepath, glm::vec2 tileDimensions)
+{
+	AssetID id = hashAssetName(name);
+	assert(!isTextureLoaded(id));
+
+#ifdef _DEBUG
+	checkForCollision(m_textureNames, id, name);
+#endif
+
+	FIBITMAP* dib = loadImage(filepath);
 	if (!dib)
-		return 0;
+		return Texture();
 
-	textureData = FreeImage_GetBits(dib);
-	width = FreeImage_GetWidth(dib);
-	height = FreeImage_GetHeight(dib);
-
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	FREE_IMAGE_COLOR_TYPE colorType = FreeImage_GetColorType(dib);
-	if(colorType == FIC_RGBALPHA)
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, textureData);
-	else
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, textureData);
+	unsigned char* textureData = FreeImage_GetBits(dib);
+	unsigned int width = FreeImage_GetWidth(dib);
+	unsigned int height = FreeImage_GetHeight(dib);
+
+	if (tileDimensions == glm::vec2())
+		tileDimensions = glm::vec2(width, height);
+
+	Texture texture = m_textureAtlas->add(textureData, width, height, glm::ivec2(tileDimensions));
+	if (texture.id == 0)
+		texture = Texture(glm::vec2(width, height), GraphicsDevice::getInstance()->createTexture(width, height, true, textureData));
 
 	FreeImage_Unload(dib);
 
-	m_textureMap[name] = textureID;
-	return textureID;
+	addTexture(id, texture);
+	return texture;
 }
 
 unsigned int AssetManager::loadShader(const char* name, const char* vertexFilepath, const char* fragmentFilepath)
 {
-	assert(m_shaderProgramMap.find(name) == m_shaderProgramMap.end());
+	AssetID id = hashAssetName(name);
+	assert(!isShaderLoaded(id));
+
+#ifdef _DEBUG
+	checkForCollision(m_shaderProgramNames, id, name);
+#endif
 
 	unsigned int vertexShader = readShader(vertexFilepath, GL_VERTEX_SHADER);
 	unsigned int fragmentShader = readShader(fragmentFilepath, GL_FRAGMENT_SHADER);
@@ -124,88 +230,387 @@ unsigned int AssetManager::loadShader(const char* name, const char* vertexFilepa
 
 	if (!shaderProgram) return 0;
 
-	m_shaderProgramMap[name] = shaderProgram;
+	addShader(id, shaderProgram);
 	return shaderProgram;
 }
 
+void AssetManager::loadTextureAsync(const char* name, const char* filepath, glm::vec2 tileDimensions, TextureCallback callback)
+{
+	AssetID id = hashAssetName(name);
+	assert(!isTextureLoaded(id));
+
+#ifdef _DEBUG
+	checkForCollision(m_textureNames, id, name);
+#endif
+
+	PendingTexture* texture = new PendingTexture();
+	texture->id = id;
+	texture->name = name;
+	texture->callback = callback;
+	texture->isStaged = false;
+	texture->isUploaded = false;
+	texture->decodeThread = std::async(std::launch::async, &AssetManager::decodeTextureThreaded, texture, m_textureAtlas, std::string(filepath), glm::ivec2(tileDimensions));
+
+	m_pendingTextures.push_back(texture);
+}
+
+void AssetManager::loadShaderAsync(const char* name, const char* vertexFilepath, const char* fragmentFilepath, ShaderCallback callback)
+{
+	AssetID id = hashAssetName(name);
+	assert(!isShaderLoaded(id));
+
+#ifdef _DEBUG
+	checkForCollision(m_shaderProgramNames, id, name);
+#endif
+
+	PendingShader* shader = new PendingShader();
+	shader->id = id;
+	shader->name = name;
+	shader->callback = callback;
+	shader->isStaged = false;
+	shader->program = 0;
+	shader->isCompiled = false;
+
+	// The defines are copied, so ones added after this don't race with the worker
+	shader->readThread = std::async(std::launch::async, &AssetManager::readShaderThreaded, shader, std::string(vertexFilepath), std::string(fragmentFilepath), m_shaderDefines);
+
+	m_pendingShaders.push_back(shader);
+}
+
+void AssetManager::addShaderDefine(const char* name, int value)
+{
+	// Only shaders loaded after this will have the define
+	m_shaderDefines += "#define " + std::string(name) + " " + std::to_string(value) + "\n";
+}
+
 unsigned int AssetManager::readShader(const char* shaderPath, unsigned int shaderType)
 {
 	if (m_shaderMap.find(shaderPath) != m_shaderMap.end())
 		return m_shaderMap[shaderPath];
 
-	std::ifstream ifs(shaderPath, std::ios::in | std::ios::binary | std::ios::ate);
-	if (ifs.is_open())
+	std::string shaderSource;
+	if (!readFile(shaderPath, shaderSource))
 	{
-		int filesize = (int)ifs.tellg();
-		ifs.seekg(0, ifs.beg);
+		Output::error("Failed to open file " + std::string(shaderPath));
+		return 0;
+	}
+
+	insertShaderDefines(shaderSource, m_shaderDefines);
 
-		char* shaderBuffer = new char[filesize + 1];
-		ifs.read(shaderBuffer, filesize);
-		shaderBuffer[filesize] = '\0';
+	unsigned int shader = compileShader(shaderSource, shaderType);
+	if (!shader) return 0;
 
-		ifs.close();
+	m_shaderMap[shaderPath] = shader;
+	return shader;
+}
 
-		unsigned int shader = glCreateShader(shaderType);
-		glShaderSource(shader, 1, &shaderBuffer, nullptr);
-		glCompileShader(shader);
+unsigned int AssetManager::createShaderProgram(unsigned int vertexShader, unsigned int fragmentShader)
+{
+	std::string errorLog;
+	unsigned int shaderProgram = GraphicsDevice::getInstance()->createProgram(vertexShader, fragmentShader, errorLog);
 
-		delete[] shaderBuffer;
+	if (!shaderProgram)
+	{
+		Output::error("Failed to link shader program: " + errorLog);
+		return 0;
+	}
 
-		int success;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	return shaderProgram;
+}
 
-		if (!success)
-		{
-			int errorLogLength;
-			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &errorLogLength);
+void AssetManager::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
 
-			char* errorBuffer = new char[errorLogLength];
-			glGetShaderInfoLog(shader, errorLogLength, &errorLogLength, errorBuffer);
+	switch (type)
+	{
+	case COMMAND_CREATE_PAGE:
+	{
+		const CreatePageCommand* command = static_cast<const CreatePageCommand*>(data);
+		int pageSize = m_textureAtlas->getPageSize();
+		m_textureAtlas->setPageTexture(command->pageIndex, device->createTexture(pageSize, pageSize, true, nullptr));
+		break;
+	}
+	case COMMAND_UPLOAD_TEXTURE:
+	{
+		const UploadTextureCommand* command = static_cast<const UploadTextureCommand*>(data);
+		PendingTexture* texture = command->texture;
 
-			glDeleteShader(shader);
-			if (shaderType == GL_VERTEX_SHADER)
-				Output::error("Failed to compile vertex shader:\n" + std::string(errorBuffer));
-			else if (shaderType == GL_FRAGMENT_SHADER)
-				Output::error("Failed to compile fragment shader:\n" + std::string(errorBuffer));
+		m_uploadBuffer->uploadTexture(m_textureAtlas->getPageTexture(texture->pageIndex), texture->position.x, texture->position.y,
+			texture->paddedSize.x, texture->paddedSize.y, command + 1);
 
-			delete[] errorBuffer;
-			return 0;
-		}
+		texture->isUploaded = true;
+		break;
+	}
+	case COMMAND_COMPILE_SHADER:
+	{
+		PendingShader* shader = static_cast<const CompileShaderCommand*>(data)->shader;
 
-		m_shaderMap[shaderPath] = shader;
-		return shader;
+		unsigned int vertexShader = compileShader(shader->vertexSource, GL_VERTEX_SHADER);
+		unsigned int fragmentShader = compileShader(shader->fragmentSource, GL_FRAGMENT_SHADER);
+
+		// The program keeps what it needs, so the shaders aren't kept around like the ones loaded all at once
+		if (vertexShader && fragmentShader)
+			shader->program = createShaderProgram(vertexShader, fragmentShader);
+
+		if (vertexShader) device->deleteShader(vertexShader);
+		if (fragmentShader) device->deleteShader(fragmentShader);
+
+		shader->isCompiled = true;
+		break;
 	}
-	else
+	case COMMAND_END_UPLOADS:
+		m_uploadBuffer->endFrame();
+		break;
+	}
+}
+
+bool AssetManager::readFile(const char* filepath, std::string& contents)
+{
+	std::ifstream ifs(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!ifs.is_open())
+		return false;
+
+	int filesize = (int)ifs.tellg();
+	ifs.seekg(0, ifs.beg);
+
+	contents.resize(filesize);
+	ifs.read(&contents[0], filesize);
+	ifs.close();
+
+	return true;
+}
+
+void AssetManager::insertShaderDefines(std::string& source, const std::string& defines)
+{
+	// Insert the defines after the version directive, since it has to come first
+	if (!defines.empty() && source.compare(0, 8, "#version") == 0)
 	{
-		Output::error("Failed to open file " + std::string(shaderPath));
-		return 0;
+		size_t versionLineEnd = source.find('\n');
+		if (versionLineEnd != std::string::npos)
+			source.insert(versionLineEnd + 1, defines + "#line 2\n");
 	}
 }
 
-unsigned int AssetManager::createShaderProgram(unsigned int vertexShader, unsigned int fragmentShader)
+unsigned int AssetManager::compileShader(const std::string& source, unsigned int shaderType)
 {
-	unsigned int shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
+	std::string errorLog;
+	unsigned int shader = GraphicsDevice::getInstance()->createShader(shaderType, source, errorLog);
 
-	int success;
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+	if (!shader)
+	{
+		if (shaderType == GL_VERTEX_SHADER)
+			Output::error("Failed to compile vertex shader:\n" + errorLog);
+		else if (shaderType == GL_FRAGMENT_SHADER)
+			Output::error("Failed to compile fragment shader:\n" + errorLog);
+	}
 
-	if (!success)
+	return shader;
+}
+
+bool AssetManager::decodeTextureThreaded(PendingTexture* texture, const TextureAtlas* atlas, std::string filepath, glm::ivec2 tileDimensions)
+{
+	FIBITMAP* dib = loadImage(filepath.c_str());
+	if (!dib)
 	{
-		int errorLogLength;
-		glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &errorLogLength);
+		Output::error("ERROR: Failed to load texture " + filepath);
+		return false;
+	}
 
-		char* errorBuffer = new char[errorLogLength];
-		glGetProgramInfoLog(shaderProgram, errorLogLength, &errorLogLength, errorBuffer);
+	int width = FreeImage_GetWidth(dib);
+	int height = FreeImage_GetHeight(dib);
+	texture->dimensions = glm::ivec2(width, height);
 
-		glDeleteProgram(shaderProgram);
-		Output::error("Failed to link shader program: " + std::string(errorBuffer));
+	if (tileDimensions == glm::ivec2())
+		tileDimensions = texture->dimensions;
 
-		delete[] errorBuffer;
-		return 0;
+	bool isPadded = atlas->pad(FreeImage_GetBits(dib), width, height, tileDimensions, texture->padded, texture->paddedSize);
+	FreeImage_Unload(dib);
+
+	if (!isPadded)
+	{
+		Output::error("ERROR: Texture " + filepath + " doesn't fit in an atlas page, so it can't be loaded asynchronously");
+		return false;
 	}
 
-	return shaderProgram;
+	return true;
+}
+
+bool AssetManager::readShaderThreaded(PendingShader* shader, std::string vertexFilepath, std::string fragmentFilepath, std::string defines)
+{
+	if (!readFile(vertexFilepath.c_str(), shader->vertexSource))
+	{
+		Output::error("Failed to open file " + vertexFilepath);
+		return false;
+	}
+
+	if (!readFile(fragmentFilepath.c_str(), shader->fragmentSource))
+	{
+		Output::error("Failed to open file " + fragmentFilepath);
+		return false;
+	}
+
+	insertShaderDefines(shader->vertexSource, defines);
+	insertShaderDefines(shader->fragmentSource, defines);
+
+	return true;
+}
+
+TextureHandle AssetManager::addTexture(AssetID id, const Texture& texture)
+{
+	TextureHandle handle;
+	handle.index = (unsigned int)m_textures.size();
+
+	m_textures.push_back(texture);
+	m_textureIndices[id] = handle.index;
+
+	return handle;
+}
+
+ShaderHandle AssetManager::addShader(AssetID id, unsigned int program)
+{
+	ShaderHandle handle;
+	handle.index = (unsigned int)m_shaderPrograms.size();
+
+	m_shaderPrograms.push_back(program);
+	m_shaderProgramIndices[id] = handle.index;
+
+	return handle;
+}
+
+#ifdef _DEBUG
+void AssetManager::checkForCollision(std::unordered_map<AssetID, std::string>& names, AssetID id, const char* name)
+{
+	auto it = names.find(id);
+	if (it == names.end())
+	{
+		names[id] = name;
+		return;
+	}
+
+	if (it->second != name)
+	{
+		Output::error("ERROR: The asset names \"" + it->second + "\" and \"" + std::string(name) + "\" have the same ID. Rename one of them.");
+		exit(EXIT_FAILURE);
+	}
+}
+#endif
+
+void AssetManager::updatePendingTextures()
+{
+	RenderQueue* renderQueue = RenderQueue::getInstance();
+	size_t bytesStaged = 0;
+
+	for (size_t i = 0; i < m_pendingTextures.size(); )
+	{
+		PendingTexture* texture = m_pendingTextures[i];
+		bool isFinished = false;
+		bool isLoaded = false;
+
+		if (texture->isStaged)
+		{
+			isFinished = texture->isUploaded;
+			isLoaded = isFinished;
+		}
+		else if (texture->decodeThread.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			if (!texture->decodeThread.get())
+			{
+				isFinished = true;
+			}
+			else if (bytesStaged == 0 || bytesStaged + texture->padded.size() * 4 <= ASSET_UPLOAD_BYTES_PER_FRAME)
+			{
+				bool isNewPage;
+				if (!m_textureAtlas->place(texture->paddedSize, texture->pageIndex, texture->position, isNewPage))
+				{
+					Output::error("ERROR: The texture atlas is full, so texture " + texture->name + " can't be loaded asynchronously");
+					isFinished = true;
+				}
+				else
+				{
+					if (isNewPage)
+						renderQueue->record<CreatePageCommand>(this, COMMAND_CREATE_PAGE)->pageIndex = texture->pageIndex;
+
+					// The pixels are copied into the command, so they can be freed now rather than when the upload finishes
+					size_t pixelsSize = texture->padded.size() * 4;
+					UploadTextureCommand* command = renderQueue->record<UploadTextureCommand>(this, COMMAND_UPLOAD_TEXTURE, pixelsSize);
+					command->texture = texture;
+					memcpy_s(command + 1, pixelsSize, texture->padded.data(), pixelsSize);
+					std::vector<unsigned int>().swap(texture->padded);
+
+					texture->isStaged = true;
+					bytesStaged += pixelsSize;
+				}
+			}
+		}
+
+		if (!isFinished)
+		{
+			i++;
+			continue;
+		}
+
+		Texture result;
+		if (isLoaded)
+		{
+			result = m_textureAtlas->getTexture(texture->pageIndex, texture->position, texture->dimensions);
+			addTexture(texture->id, result);
+		}
+
+		if (texture->callback)
+			texture->callback(result);
+
+		delete texture;
+		m_pendingTextures[i] = m_pendingTextures.back();
+		m_pendingTextures.pop_back();
+	}
+
+	// Lets the ring reuse the space once the GPU has copied out of it
+	if (bytesStaged > 0)
+		renderQueue->record(this, COMMAND_END_UPLOADS, 0);
+}
+
+void AssetManager::updatePendingShaders()
+{
+	for (size_t i = 0; i < m_pendingShaders.size(); )
+	{
+		PendingShader* shader = m_pendingShaders[i];
+		bool isFinished = false;
+
+		if (shader->isStaged)
+		{
+			isFinished = shader->isCompiled;
+		}
+		else if (shader->readThread.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			if (shader->readThread.get())
+			{
+				RenderQueue::getInstance()->record<CompileShaderCommand>(this, COMMAND_COMPILE_SHADER)->shader = shader;
+				shader->isStaged = true;
+			}
+			else
+			{
+				isFinished = true;
+			}
+		}
+
+		if (!isFinished)
+		{
+			i++;
+			continue;
+		}
+
+		unsigned int program = shader->program;
+		if (program)
+			addShader(shader->id, program);
+		else
+			Output::error("ERROR: Failed to load shader " + shader->name);
+
+		if (shader->callback)
+			shader->callback(program);
+
+		delete shader;
+		m_pendingShaders[i] = m_pendingShaders.back();
+		m_pendingShaders.pop_back();
+	}
 }
@@ -1,26 +1,167 @@
 #pragma once
 
-class AssetManager
+#include "AssetID.h"
+#include "RenderQueue.h"
+#include "TextureAtlas.h"
+
+#include <functional>
+#include <future>
+
+#define ASSET_UPLOAD_BYTES_PER_FRAME (4 * 1024 * 1024) // How many bytes of texture data async loads upload each frame. At least one texture is uploaded every frame, however big.
+
+class UploadRingBuffer;
+
+// Loads textures and shaders, and keeps them by the hash of their name. Hot paths should find an asset's handle once,
+// and then resolve the handle each time it's used, which is just an index into a table. Assets can be loaded all at once, which blocks until they're ready,
+// or asynchronously: the files are read and decoded on worker threads, and the textures are uploaded a few per frame
+// through a pixel buffer object, so loading doesn't stall the window. Async assets are only available once their callback is called.
+class AssetManager : public RenderCommandHandler
 {
 public:
+	typedef std::function<void(const Texture&)> TextureCallback; // Called with a texture with an ID of 0 if loading failed
+	typedef std::function<void(unsigned int)> ShaderCallback; // Called with 0 if loading failed
+
 	AssetManager();
 	~AssetManager();
 
 	static AssetManager* getInstance();
 
-	unsigned int getTexture(const char* name);
-	unsigned int getShader(const char* name);
+	// Finishes async loads that are ready and starts uploading the next ones. Call once per frame from the simulation.
+	void update();
+
+	// Use ASSET_ID for names known at compile time, so they aren't hashed every call
+	Texture getTexture(AssetID id) const;
+	unsigned int getShader(AssetID id) const;
+
+	TextureHandle getTextureHandle(AssetID id) const;
+	ShaderHandle getShaderHandle(AssetID id) const;
+
+	const Texture& getTexture(TextureHandle handle) const;
+	unsigned int getShader(ShaderHandle handle) const;
+
+	bool isTextureLoaded(AssetID id) const;
+	bool isShaderLoaded(AssetID id) const;
+	size_t getPendingAssetCount() const;
 
-	unsigned int loadTexture(const char* name, const char* filepath);
+	// Textures are packed into the texture atlas, split into tiles of the tile dimensions, or as a single tile if they're 0.
+	// Textures too big for an atlas page get a texture of their own.
+	Texture loadTexture(const char* name, const char* filepath, glm::vec2 tileDimensions = glm::vec2());
 	unsigned int loadShader(const char* name, const char* vertexFilepath, const char* fragmentFilepath);
 
+	// Like loadTexture, except textures too big for an atlas page fail to load
+	void loadTextureAsync(const char* name, const char* filepath, glm::vec2 tileDimensions = glm::vec2(), TextureCallback callback = nullptr);
+	void loadShaderAsync(const char* name, const char* vertexFilepath, const char* fragmentFilepath, ShaderCallback callback = nullptr);
+
+	void addShaderDefine(const char* name, int value);
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
+
 private:
+	enum CommandType
+	{
+		COMMAND_CREATE_PAGE,
+		COMMAND_UPLOAD_TEXTURE,
+		COMMAND_COMPILE_SHADER,
+		COMMAND_END_UPLOADS
+	};
+
+	// A texture being loaded asynchronously. The worker fills in the padded pixels, the simulation places them in the
+	// atlas, and the render thread uploads them.
+	struct PendingTexture
+	{
+		AssetID id;
+		std::string name; // Kept for error messages
+		TextureCallback callback;
+
+		std::future<bool> decodeThread;
+		std::vector<unsigned int> padded;
+		glm::ivec2 paddedSize;
+		glm::ivec2 dimensions;
+
+		size_t pageIndex;
+		glm::ivec2 position;
+		bool isStaged; // Whether the upload has been recorded
+		std::atomic<bool> isUploaded;
+	};
+
+	// A shader program being loaded asynchronously. The worker reads the sources and the render thread compiles them.
+	struct PendingShader
+	{
+		AssetID id;
+		std::string name; // Kept for error messages
+		ShaderCallback callback;
+
+		std::future<bool> readThread;
+		std::string vertexSource;
+		std::string fragmentSource;
+
+		bool isStaged; // Whether the compile has been recorded
+		std::atomic<unsigned int> program;
+		std::atomic<bool> isCompiled;
+	};
+
+	struct CreatePageCommand
+	{
+		size_t pageIndex;
+	};
+
+	// Followed by the padded pixels
+	struct UploadTextureCommand
+	{
+		PendingTexture* texture;
+	};
+
+	struct CompileShaderCommand
+	{
+		PendingShader* shader;
+	};
+
+	static bool readFile(const char* filepath, std::string& contents);
+	static void insertShaderDefines(std::string& source, const std::string& defines);
+	static unsigned int compileShader(const std::string& source, unsigned int shaderType);
+
+	static bool decodeTextureThreaded(PendingTexture* texture, const TextureAtlas* atlas, std::string filepath, glm::ivec2 tileDimensions);
+	static bool readShaderThreaded(PendingShader* shader, std::string vertexFilepath, std::string fragmentFilepath, std::string defines);
+
+	TextureHandle addTexture(AssetID id, const Texture& texture);
+	ShaderHandle addShader(AssetID id, unsigned int program);
+
+#ifdef _DEBUG
+	// Exits if a different name already hashed to the same ID, since one of the assets would be unreachable
+	static void checkForCollision(std::unordered_map<AssetID, std::string>& names, AssetID id, const char* name);
+#endif
+
+	void updatePendingTextures();
+	void updatePendingShaders();
+
 	unsigned int readShader(const char* shaderPath, unsigned int shaderType);
 	unsigned int createShaderProgram(unsigned int vertexShader, unsigned int fragmentShader);
 
 	static AssetManager* m_instance;
 
-	std::unordered_map<const char*, unsigned int> m_textureMap;
-	std::unordered_map<const char*, unsigned int> m_shaderMap;
-	std::unordered_map<const char*, unsigned int> m_shaderProgramMap;
-};
\ No newline at end of file
+	TextureAtlas* m_textureAtlas;
+
+	// Assets are never unloaded, so their handles stay valid and the tables stay dense
+	std::vector<Texture> m_textures;
+	std::vector<unsigned int> m_shaderPrograms;
+	std::unordered_map<AssetID, unsigned int> m_textureIndices;
+	std::unordered_map<AssetID, unsigned int> m_shaderProgramIndices;
+	Texture m_emptyTexture; // What invalid texture handles resolve to
+
+	std::unordered_map<std::string, unsigned int> m_shaderMap; // Compiled shaders by filepath, shared between programs
+
+#ifdef _DEBUG
+	// The names behind each ID, to catch collisions
+	std::unordered_map<AssetID, std::string> m_textureNames;
+	std::unordered_map<AssetID, std::string> m_shaderProgramNames;
+#endif
+
+	std::string m_shaderDefines; // Defines added to the top of every shader so they match the engine's compile time constants
+
+	// Only used by the simulation
+	std::vector<PendingTexture*> m_pendingTextures;
+	std::vector<PendingShader*> m_pendingShaders;
+
+	// Only used on the render thread once it has started
+	UploadRingBuffer* m_uploadBuffer;
+};
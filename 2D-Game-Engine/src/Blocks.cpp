@@ -8,7 +8,7 @@ BlockContainer::BlockContainer()
 	AssetManager* assetManager = AssetManager::getInstance();
 
 	unsigned int terrainShaderID = assetManager->loadShader("terrainShader", "shaders/terrainVertexShader.glsl", "shaders/fragmentShader.glsl");
-	unsigned int blockSpritesheet = assetManager->loadTexture("blockSpritesheet", "textures/block_spritesheet2.png");
+	Texture blockSpritesheet = assetManager->loadTexture("blockSpritesheet", "textures/block_spritesheet2.png", glm::vec2(16));
 	
 	RendererSystem* renderSystem = RendererSystem::getInstance();
 
@@ -17,27 +17,27 @@ BlockContainer::BlockContainer()
 
 	// Dirt
 	glm::vec2 uvOffsetsDirt[MAX_ANIMATION_LENGTH] = { glm::vec2(1, 1) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsDirt);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsDirt);
 
 	// Grass
 	glm::vec2 uvOffsetsGrass[MAX_ANIMATION_LENGTH] = { glm::vec2(0, 0), glm::vec2(0, 1), glm::vec2(0, 2), glm::vec2(1, 2), glm::vec2(2, 2), glm::vec2(2, 1), glm::vec2(2, 0), glm::vec2(1, 0) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsGrass);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsGrass);
 	
 	// Stone
 	glm::vec2 uvOffsetsStone[MAX_ANIMATION_LENGTH] = { glm::vec2(4, 1) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsStone);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsStone);
 
 	// Wood
 	glm::vec2 uvOffsetsWood[MAX_ANIMATION_LENGTH] = { glm::vec2(6, 1) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsWood);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsWood);
 
 	// Branch
 	glm::vec2 uvOffsetsBranch[MAX_ANIMATION_LENGTH] = { glm::vec2(6, 1) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsBranch);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsBranch);
 
 	// Leaf
 	glm::vec2 uvOffsetsLeaf[MAX_ANIMATION_LENGTH] = { glm::vec2(6, 2) };
-	renderSystem->addComponent(0, Texture(glm::vec2(256), blockSpritesheet), glm::vec2(16), terrainShaderID, 0, uvOffsetsLeaf);
+	renderSystem->addComponent(0, blockSpritesheet, glm::vec2(16), terrainShaderID, 0, uvOffsetsLeaf);
 
 	m_blockRenderData = renderSystem->getComponents(0);
 }
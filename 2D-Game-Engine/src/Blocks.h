@@ -5,7 +5,10 @@
 #include "Systems/RenderSystem.h"
 #include "Systems/PhysicsSystem.h"
 
-#define BLOCK_SIZE 16 // The size of a block in pixels
+#ifndef BLOCK_SIZE
+	#define BLOCK_SIZE 16 // The size of a block in pixels
+#endif
+
 #define BLOCK_COUNT 7 // The number of different blocks
 
 enum BlockType
@@ -2,10 +2,11 @@
 #include "Camera.h"
 
 Camera::Camera(int width, int height)
+	: m_zoom(1.0f)
 {
 	m_position = glm::vec2();
-	glm::vec3 positionVec3 = glm::vec3(m_position, 0.0f);
-	m_view = glm::lookAt(positionVec3, positionVec3 + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	m_viewPosition = glm::vec2();
+	m_view = glm::mat4(1.0f);
 
 	resize(width, height);
 }
@@ -29,12 +30,41 @@ int Camera::getHeight() const
 	return m_height;
 }
 
+float Camera::getZoom() const
+{
+	return m_zoom;
+}
+
+glm::vec2 Camera::getViewSize() const
+{
+	// The size of the world area the camera can see
+	return glm::vec2(m_width, m_height) / m_zoom;
+}
+
+glm::vec2 Camera::getViewPosition() const
+{
+	return m_viewPosition;
+}
+
+glm::vec2 Camera::screenToWorld(glm::vec2 screenPosition) const
+{
+	// Screen positions start at the top left of the window, with y pointing down
+	glm::vec2 offset = glm::vec2(screenPosition.x - m_width * 0.5f, m_height * 0.5f - screenPosition.y) / m_zoom;
+
+	return m_viewPosition + offset;
+}
+
 void Camera::translate(glm::vec2 delta)
 {
 	m_position += delta;
 	glm::vec3 position = glm::vec3(m_position, 0.0f);
-	position.y = fminf(CAMERA_VERTICAL_CLAMP - m_height * 0.5f, fmaxf(position.y, -CAMERA_VERTICAL_CLAMP + m_height * 0.5f));
-	m_view = glm::lookAt(position, position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	float viewHeight = getViewSize().y;
+	position.y = fminf(CAMERA_VERTICAL_CLAMP - viewHeight * 0.5f, fmaxf(position.y, -CAMERA_VERTICAL_CLAMP + viewHeight * 0.5f));
+
+	// The camera always looks straight down the z axis, so the view is just a translation
+	m_viewPosition = glm::vec2(position);
+	m_view = glm::translate(glm::mat4(1.0f), -position);
+	m_viewProjection = m_projection * m_view;
 }
 
 void Camera::resize(int width, int height)
@@ -42,7 +72,18 @@ void Camera::resize(int width, int height)
 	m_width = width;
 	m_height = height;
 
-	m_projection = glm::ortho(-m_width * 0.5f, m_width * 0.5f, -m_height * 0.5f, m_height * 0.5f, 0.0f, 1.0f);
+	glm::vec2 viewSize = getViewSize();
+	m_projection = glm::ortho(-viewSize.x * 0.5f, viewSize.x * 0.5f, -viewSize.y * 0.5f, viewSize.y * 0.5f, 0.0f, 1.0f);
+	m_viewProjection = m_projection * m_view;
+}
+
+void Camera::setZoom(float zoom)
+{
+	m_zoom = fminf(CAMERA_ZOOM_MAX, fmaxf(zoom, CAMERA_ZOOM_MIN));
+
+	// Rebuild the projection and reclamp the position for the new view size
+	resize(m_width, m_height);
+	translate(glm::vec2());
 }
 
 const glm::mat4& Camera::getViewMatrix() const
@@ -54,3 +95,8 @@ const glm::mat4& Camera::getProjectionMatrix() const
 {
 	return m_projection;
 }
+
+const glm::mat4& Camera::getViewProjectionMatrix() const
+{
+	return m_viewProjection;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #define CAMERA_VERTICAL_CLAMP 17408
+#define CAMERA_ZOOM_MIN 0.125f // The furthest the camera can zoom out
+#define CAMERA_ZOOM_MAX 4.0f // The furthest the camera can zoom in
 
 class Camera
 {
@@ -12,18 +14,30 @@ public:
 	int getWidth() const;
 	int getHeight() const;
 
+	float getZoom() const;
+	glm::vec2 getViewSize() const;
+	glm::vec2 getViewPosition() const;
+
+	glm::vec2 screenToWorld(glm::vec2 screenPosition) const;
+
 	void translate(glm::vec2 delta);
 	void resize(int width, int height);
+	void setZoom(float zoom);
 
 	const glm::mat4& getViewMatrix() const;
 	const glm::mat4& getProjectionMatrix() const;
+	const glm::mat4& getViewProjectionMatrix() const;
 
 private:
 	glm::mat4 m_projection;
 	glm::mat4 m_view;
+	glm::mat4 m_viewProjection; // Rebuilt whenever the view or projection changes, so shaders don't multiply them per vertex
 
 	glm::vec2 m_position;
+	glm::vec2 m_viewPosition; // The position the camera is looking at, after being clamped
 
 	int m_width;
 	int m_height;
+
+	float m_zoom; // Greater than 1 zooms in, less than 1 zooms out
 };
\ No newline at end of file
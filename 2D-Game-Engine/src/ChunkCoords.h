@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+// The position of a chunk in the world in chunks. These are 64 bit integers so that chunks stay exactly addressable
+// however far they are from the world origin, unlike the float positions used for rendering and physics.
+struct ChunkCoords
+{
+	ChunkCoords() : x(0), y(0) {}
+	ChunkCoords(int64_t x, int64_t y) : x(x), y(y) {}
+
+	// Gets the coordinates of the chunk that contains a block, given in blocks from the world origin
+	static ChunkCoords fromBlock(int64_t blockX, int64_t blockY, int64_t chunkSize)
+	{
+		return ChunkCoords(floorDiv(blockX, chunkSize), floorDiv(blockY, chunkSize));
+	}
+
+	static int64_t floorDiv(int64_t value, int64_t divisor)
+	{
+		int64_t quotient = value / divisor;
+		return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+	}
+
+	ChunkCoords operator+(const ChunkCoords& other) const { return ChunkCoords(x + other.x, y + other.y); }
+	ChunkCoords operator-(const ChunkCoords& other) const { return ChunkCoords(x - other.x, y - other.y); }
+	ChunkCoords& operator+=(const ChunkCoords& other) { x += other.x; y += other.y; return *this; }
+
+	bool operator==(const ChunkCoords& other) const { return x == other.x && y == other.y; }
+	bool operator!=(const ChunkCoords& other) const { return !(*this == other); }
+
+	int64_t x;
+	int64_t y;
+};
+
+// A rectangle of chunks in chunk coordinates, including its edges
+struct ChunkRect
+{
+	ChunkRect() : left(0), bottom(0), right(-1), top(-1) {}
+	ChunkRect(int64_t left, int64_t bottom, int64_t right, int64_t top) : left(left), bottom(bottom), right(right), top(top) {}
+
+	bool contains(int64_t x, int64_t y) const { return x >= left && x <= right && y >= bottom && y <= top; }
+	bool contains(const ChunkCoords& chunkCoords) const { return contains(chunkCoords.x, chunkCoords.y); }
+	bool operator==(const ChunkRect& other) const { return left == other.left && bottom == other.bottom && right == other.right && top == other.top; }
+	bool operator!=(const ChunkRect& other) const { return !(*this == other); }
+
+	int64_t left;
+	int64_t bottom;
+	int64_t right;
+	int64_t top;
+};
+
+namespace std
+{
+	template<>
+	struct hash<ChunkCoords>
+	{
+		size_t operator()(const ChunkCoords& chunkCoords) const
+		{
+			return (size_t)((chunkCoords.x * 73856093) ^ (chunkCoords.y * 83492791));
+		}
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Blocks.h"
+
+// Chunk sizes other than the default can be tried by defining CHUNK_SIZE for the whole project (e.g. /DCHUNK_SIZE=32).
+// The same value is handed to the shaders through AssetManager::addShaderDefine.
+#ifndef CHUNK_SIZE
+	#define CHUNK_SIZE 64 // The width (and height) of a chunk in blocks
+#endif
+
+static_assert(CHUNK_SIZE > 0 && (CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0, "CHUNK_SIZE must be a power of two");
+static_assert(CHUNK_SIZE <= 256, "CHUNK_SIZE is too large for a chunk's block arrays to be kept on the stack while generating");
+
+#ifndef TERRAIN_LOD_LEVELS
+	#define TERRAIN_LOD_LEVELS 4 // Number of terrain detail levels, each made of tiles twice as wide as the last (1x1, 2x2, 4x4 and 8x8 blocks)
+#endif
+
+static_assert(TERRAIN_LOD_LEVELS > 0 && (CHUNK_SIZE >> (TERRAIN_LOD_LEVELS - 1)) > 0, "A chunk must be at least one tile wide at every detail level");
+
+// The number of tiles in a chunk that is Size blocks wide, summed over Levels detail levels
+template<int Size, int Levels>
+struct ChunkLodTileCount
+{
+	static const int value = Size * Size + ChunkLodTileCount<Size / 2, Levels - 1>::value;
+};
+
+template<int Size>
+struct ChunkLodTileCount<Size, 0>
+{
+	static const int value = 0;
+};
+
+// The compile time dimensions and byte sizes of a chunk that is Size blocks wide
+template<int Size>
+struct ChunkLayout
+{
+	static const int size = Size;
+	static const int blockCount = Size * Size;
+	static const int worldSize = Size * BLOCK_SIZE; // The width of the chunk in pixels
+
+	// The number of tiles in the chunk at a detail level
+	static constexpr int lodTileCount(int level) { return blockCount >> (level * 2); }
+
+	// Where a detail level's tiles start in the chunk's instances, which hold every level one after the other
+	static constexpr int lodOffset(int level) { return level == 0 ? 0 : lodOffset(level - 1) + lodTileCount(level - 1); }
+
+	static const int instanceCount = ChunkLodTileCount<Size, TERRAIN_LOD_LEVELS>::value;
+
+	static const size_t blockBytes = sizeof(Block) * blockCount;
+	static const size_t uploadBytes = sizeof(unsigned char) * 2 * instanceCount; // The bytes sent to the GPU when a chunk's drawing buffers are updated
+};
+
+template<int Size>
+struct BasicChunk;
+
+typedef BasicChunk<CHUNK_SIZE> Chunk;
@@ -3,18 +3,42 @@
 
 #define MAX_ANIMATION_LENGTH 30
 
+// The amount that should be subtracted from the tile dimensions of textures that aren't in an atlas when rendering to fix gridlike artifacts
+#define TEXTURE_SHRINK_FACTOR FLT_EPSILON * 10
+
+// A texture, or a texture's part of an atlas page. The shaders sample a tile as (uv + uvOffset) / uvOffsetScaleFactor,
+// so the helpers turn a tile's position in the texture into where it is in the page.
 struct Texture
 {
-	Texture() : dimensions(glm::vec2()), id(0) {}
-	Texture(glm::vec2 dimensions, unsigned int id) : dimensions(dimensions), id(id) {}
+	Texture() : dimensions(glm::vec2()), id(0), pageDimensions(glm::vec2()), atlasPosition(glm::vec2()), padding(0.0f) {}
+	Texture(glm::vec2 dimensions, unsigned int id) : dimensions(dimensions), id(id), pageDimensions(dimensions), atlasPosition(glm::vec2()), padding(0.0f) {}
+
+	// The tile is counted in tiles from the texture's bottom left corner
+	glm::vec2 getUVOffset(glm::vec2 tile, glm::vec2 tileDimensions) const
+	{
+		return (atlasPosition + padding + tile * (tileDimensions + padding * 2.0f)) / tileDimensions;
+	}
+
+	glm::vec2 getUVOffsetScaleFactor(glm::vec2 tileDimensions) const
+	{
+		// Padded tiles can be sampled right up to their edges
+		if (padding > 0.0f)
+			return pageDimensions / tileDimensions;
+
+		return pageDimensions / (tileDimensions - glm::vec2(TEXTURE_SHRINK_FACTOR));
+	}
 
 	glm::vec2 dimensions;
-	unsigned int id;
+	unsigned int id; // The page's texture when the texture is in an atlas
+
+	glm::vec2 pageDimensions; // The same as the dimensions when the texture isn't in an atlas
+	glm::vec2 atlasPosition; // The bottom left corner of the texture's first tile's padding in the page, in pixels
+	float padding; // Copies of the edge pixels around each tile in pixels, 0 when the texture isn't in an atlas
 };
 
 struct Renderable : public Component
 {
-	Renderable(size_t entityID) : Component(entityID) {}
+	Renderable(size_t entityID) : Component(entityID), frameCount(1), frameRate(0.0f) {}
 
 	void operator=(const Renderable& other)
 	{
@@ -22,6 +46,8 @@ struct Renderable : public Component
 		tileDimensions = other.tileDimensions;
 		uvOffsetIndex = other.uvOffsetIndex;
 		shaderID = other.shaderID;
+		frameCount = other.frameCount;
+		frameRate = other.frameRate;
 
 		if (other.uvOffsets)
 			memcpy_s(uvOffsets, sizeof(glm::vec2) * MAX_ANIMATION_LENGTH, other.uvOffsets, sizeof(glm::vec2) * MAX_ANIMATION_LENGTH);
@@ -34,4 +60,7 @@ struct Renderable : public Component
 	glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH];
 	unsigned int uvOffsetIndex;
 	unsigned int shaderID;
+
+	unsigned int frameCount; // The number of uv offsets the animation steps through, 1 if it isn't animated
+	float frameRate; // Animation frames per second
 };
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#include "DebugDrawPhysics.h"
+
+#include "../AssetManager.h"
+#include "../GraphicsDevice.h"
+#include "../UploadRingBuffer.h"
+#include "../Systems/PhysicsSystem.h"
+
+DebugDrawPhysics::DebugDrawPhysics(const Camera& camera)
+	: m_camera(camera), m_viewMin(), m_viewMax(), m_instanceBuffer(0), m_instanceCapacity(0)
+{
+	// The debug view is off at startup, so it doesn't hold up loading
+	m_shaderID = 0;
+	AssetManager::getInstance()->loadShaderAsync("debugPhysicsShader", "shaders/debugPhysicsVertexShader.glsl", "shaders/debugPhysicsFragmentShader.glsl", [this](unsigned int shaderID)
+	{
+		m_shaderID = shaderID;
+	});
+
+	// The meshes are unit sized, so an instance's scale is its size. Boxes are centered on their position,
+	// circles have a radius of 1, and a segment goes from its position to its position plus its scale.
+	std::vector<glm::vec2> vertices;
+
+	m_meshFirstVertex[PRIMITIVE_BOX] = (int)vertices.size();
+	vertices.push_back(glm::vec2(-0.5f, -0.5f));
+	vertices.push_back(glm::vec2(0.5f, -0.5f));
+	vertices.push_back(glm::vec2(0.5f, 0.5f));
+	vertices.push_back(glm::vec2(-0.5f, 0.5f));
+	m_meshVertexCount[PRIMITIVE_BOX] = 4;
+
+	m_meshFirstVertex[PRIMITIVE_CIRCLE] = (int)vertices.size();
+	for (int i = 0; i < DEBUG_DRAW_CIRCLE_SEGMENTS; i++)
+	{
+		float angle = b2_pi * 2.0f * i / DEBUG_DRAW_CIRCLE_SEGMENTS;
+		vertices.push_back(glm::vec2(cosf(angle), sinf(angle)));
+	}
+	m_meshVertexCount[PRIMITIVE_CIRCLE] = DEBUG_DRAW_CIRCLE_SEGMENTS;
+
+	m_meshFirstVertex[PRIMITIVE_SEGMENT] = (int)vertices.size();
+	vertices.push_back(glm::vec2(0.0f, 0.0f));
+	vertices.push_back(glm::vec2(1.0f, 1.0f));
+	m_meshVertexCount[PRIMITIVE_SEGMENT] = 2;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	m_vao = device->createVertexArray();
+	device->bindVertexArray(m_vao);
+
+	m_vertexBuffer = device->createBuffer();
+	device->bindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+
+	device->enableVertexAttribArray(0);
+	device->vertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(glm::vec2), 0);
+
+	// The instances are streamed each frame, and the buffer grows as more shapes are drawn
+	m_instanceBuffer = device->createBuffer();
+	resizeInstanceBuffer(4096);
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer = new UploadRingBuffer();
+}
+
+DebugDrawPhysics::~DebugDrawPhysics()
+{
+	delete m_uploadBuffer;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->deleteBuffer(m_instanceBuffer);
+	device->deleteBuffer(m_vertexBuffer);
+	device->deleteVertexArray(m_vao);
+}
+
+void DebugDrawPhysics::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	glm::vec2 min = toWorld(vertices[0]);
+	glm::vec2 max = min;
+	for (int32 i = 1; i < vertexCount; i++)
+	{
+		glm::vec2 vertex = toWorld(vertices[i]);
+		min = glm::min(min, vertex);
+		max = glm::max(max, vertex);
+	}
+
+	if (!isVisible(min, max)) return;
+
+	// Four edges that are each horizontal or vertical make a rectangle, which is drawn as a single box
+	bool isRectangle = vertexCount == 4;
+	for (int32 i = 0; i < vertexCount && isRectangle; i++)
+	{
+		glm::vec2 edge = glm::abs(toWorld(vertices[(i + 1) % vertexCount]) - toWorld(vertices[i]));
+		isRectangle = edge.x < 0.01f || edge.y < 0.01f;
+	}
+
+	if (isRectangle)
+	{
+		addBox(min, max, color);
+		return;
+	}
+
+	for (int32 i = 0; i < vertexCount; i++)
+	{
+		addSegment(toWorld(vertices[i]), toWorld(vertices[(i + 1) % vertexCount]), color);
+	}
+}
+
+void DebugDrawPhysics::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	// Blending is off, so solid shapes are drawn as outlines to keep what's behind them visible
+	DrawPolygon(vertices, vertexCount, color);
+}
+
+void DebugDrawPhysics::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
+{
+	glm::vec2 worldCenter = toWorld(center);
+	float worldRadius = radius * PHYSICS_PIXELS_PER_METER;
+	if (!isVisible(worldCenter - glm::vec2(worldRadius), worldCenter + glm::vec2(worldRadius))) return;
+
+	DebugDrawInstance instance;
+	instance.worldPosition = worldCenter;
+	instance.scale = glm::vec2(worldRadius);
+	instance.color = glm::vec4(color.r, color.g, color.b, color.a);
+	m_instances[PRIMITIVE_CIRCLE].push_back(instance);
+}
+
+void DebugDrawPhysics::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
+{
+	glm::vec2 worldCenter = toWorld(center);
+	float worldRadius = radius * PHYSICS_PIXELS_PER_METER;
+	if (!isVisible(worldCenter - glm::vec2(worldRadius), worldCenter + glm::vec2(worldRadius))) return;
+
+	DrawCircle(center, radius, color);
+	addSegment(worldCenter, worldCenter + glm::vec2(axis.x, axis.y) * worldRadius, color);
+}
+
+void DebugDrawPhysics::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
+{
+	glm::vec2 start = toWorld(p1);
+	glm::vec2 end = toWorld(p2);
+	if (!isVisible(glm::min(start, end), glm::max(start, end))) return;
+
+	addSegment(start, end, color);
+}
+
+void DebugDrawPhysics::DrawTransform(const b2Transform& xf)
+{
+	DrawSegment(xf.p, xf.p + DEBUG_DRAW_AXIS_LENGTH * xf.q.GetXAxis(), b2Color(1.0f, 0.0f, 0.0f));
+	DrawSegment(xf.p, xf.p + DEBUG_DRAW_AXIS_LENGTH * xf.q.GetYAxis(), b2Color(0.0f, 1.0f, 0.0f));
+}
+
+void DebugDrawPhysics::DrawPoint(const b2Vec2& p, float32 size, const b2Color& color)
+{
+	// The size is in pixels
+	glm::vec2 halfSize = glm::vec2(size * 0.5f);
+	glm::vec2 worldPosition = toWorld(p);
+	if (!isVisible(worldPosition - halfSize, worldPosition + halfSize)) return;
+
+	addBox(worldPosition - halfSize, worldPosition + halfSize, color);
+}
+
+void DebugDrawPhysics::clearInstanceData()
+{
+	// The vectors keep their capacity, so collecting doesn't allocate once they've grown to fit the world
+	for (int i = 0; i < PRIMITIVE_COUNT; i++)
+	{
+		m_instances[i].clear();
+	}
+
+	glm::vec2 halfViewSize = m_camera.getViewSize() * 0.5f;
+	m_viewMin = m_camera.getViewPosition() - halfViewSize;
+	m_viewMax = m_camera.getViewPosition() + halfViewSize;
+}
+
+void DebugDrawPhysics::draw()
+{
+	if (m_shaderID == 0) return;
+
+	size_t instanceCount = 0;
+	for (int i = 0; i < PRIMITIVE_COUNT; i++)
+	{
+		instanceCount += m_instances[i].size();
+	}
+
+	DrawCommand* command = RenderQueue::getInstance()->record<DrawCommand>(this, COMMAND_DRAW, sizeof(DebugDrawInstance) * instanceCount);
+	command->shaderID = m_shaderID;
+	DebugDrawInstance* instances = reinterpret_cast<DebugDrawInstance*>(command + 1);
+
+	for (int i = 0; i < PRIMITIVE_COUNT; i++)
+	{
+		command->instanceCounts[i] = (unsigned int)m_instances[i].size();
+		if (m_instances[i].empty()) continue;
+
+		memcpy_s(instances, sizeof(DebugDrawInstance) * m_instances[i].size(), m_instances[i].data(), sizeof(DebugDrawInstance) * m_instances[i].size());
+		instances += m_instances[i].size();
+	}
+}
+
+void DebugDrawPhysics::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice::getInstance()->setRenderPass(RENDER_PASS_DEBUG_PHYSICS);
+
+	if (type == COMMAND_DRAW)
+		executeDraw(*static_cast<const DrawCommand*>(data));
+}
+
+void DebugDrawPhysics::addBox(glm::vec2 min, glm::vec2 max, const b2Color& color)
+{
+	DebugDrawInstance instance;
+	instance.worldPosition = (min + max) * 0.5f;
+	instance.scale = max - min;
+	instance.color = glm::vec4(color.r, color.g, color.b, color.a);
+	m_instances[PRIMITIVE_BOX].push_back(instance);
+}
+
+void DebugDrawPhysics::addSegment(glm::vec2 start, glm::vec2 end, const b2Color& color)
+{
+	DebugDrawInstance instance;
+	instance.worldPosition = start;
+	instance.scale = end - start;
+	instance.color = glm::vec4(color.r, color.g, color.b, color.a);
+	m_instances[PRIMITIVE_SEGMENT].push_back(instance);
+}
+
+bool DebugDrawPhysics::isVisible(glm::vec2 min, glm::vec2 max) const
+{
+	return max.x >= m_viewMin.x && min.x <= m_viewMax.x && max.y >= m_viewMin.y && min.y <= m_viewMax.y;
+}
+
+void DebugDrawPhysics::executeDraw(const DrawCommand& command)
+{
+	size_t instanceCount = 0;
+	for (int i = 0; i < PRIMITIVE_COUNT; i++)
+	{
+		instanceCount += command.instanceCounts[i];
+	}
+
+	if (instanceCount == 0)
+	{
+		m_uploadBuffer->endFrame();
+		return;
+	}
+
+	if (instanceCount > m_instanceCapacity)
+		resizeInstanceBuffer(std::max(instanceCount, m_instanceCapacity * 2));
+
+	m_uploadBuffer->upload(m_instanceBuffer, 0, &command + 1, sizeof(DebugDrawInstance) * instanceCount);
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->useProgram(command.shaderID);
+	device->bindVertexArray(m_vao);
+
+	// How each primitive's mesh is drawn
+	static const unsigned int primitiveModes[PRIMITIVE_COUNT] = { GL_LINE_LOOP, GL_LINE_LOOP, GL_LINES };
+
+	// The instances are in primitive order, so each primitive's instances start where the last one's ended
+	unsigned int firstInstance = 0;
+	for (int i = 0; i < PRIMITIVE_COUNT; i++)
+	{
+		if (command.instanceCounts[i] > 0)
+			device->drawArraysInstancedBaseInstance(primitiveModes[i], m_meshFirstVertex[i], m_meshVertexCount[i], command.instanceCounts[i], firstInstance);
+
+		firstInstance += command.instanceCounts[i];
+	}
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer->endFrame();
+}
+
+void DebugDrawPhysics::resizeInstanceBuffer(size_t instanceCapacity)
+{
+	m_instanceCapacity = instanceCapacity;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(DebugDrawInstance) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+
+	// World position
+	device->enableVertexAttribArray(1);
+	device->vertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(DebugDrawInstance), 0);
+	device->vertexAttribDivisor(1, 1);
+
+	// Scale
+	device->enableVertexAttribArray(2);
+	device->vertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(DebugDrawInstance), sizeof(glm::vec2));
+	device->vertexAttribDivisor(2, 1);
+
+	// Color
+	device->enableVertexAttribArray(3);
+	device->vertexAttribPointer(3, 4, GL_FLOAT, false, sizeof(DebugDrawInstance), sizeof(glm::vec2) * 2);
+	device->vertexAttribDivisor(3, 1);
+
+	device->bindVertexArray(0);
+}
+
+glm::vec2 DebugDrawPhysics::toWorld(const b2Vec2& vector)
+{
+	return glm::vec2(vector.x * PHYSICS_PIXELS_PER_METER, vector.y * PHYSICS_PIXELS_PER_METER);
+}
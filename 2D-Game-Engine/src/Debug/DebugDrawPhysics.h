@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Box2D.h>
+
+#include "../Camera.h"
+#include "../RenderQueue.h"
+
+#define DEBUG_DRAW_CIRCLE_SEGMENTS 16 // Number of lines each circle outline is made of
+#define DEBUG_DRAW_AXIS_LENGTH 0.4f // Length of the axes drawn for a transform in meters
+
+class UploadRingBuffer;
+
+// A primitive's per-instance data, matching the debug physics shader's instance attributes.
+// The primitive's mesh is scaled and then moved to the world position.
+struct DebugDrawInstance
+{
+	glm::vec2 worldPosition;
+	glm::vec2 scale;
+	glm::vec4 color;
+};
+
+// Draws Box2D's debug data. Every shape is collected into an instance stream for its primitive, and each primitive
+// is drawn as outlines with a single instanced call, so a world of thousands of block fixtures is only a few draws.
+// Polygons that are axis aligned rectangles, which is every block and AABB, are drawn as boxes. Any other polygon
+// is drawn as segments. Shapes that are off screen are skipped.
+class DebugDrawPhysics : public b2Draw, public RenderCommandHandler
+{
+public:
+	DebugDrawPhysics(const Camera& camera);
+	~DebugDrawPhysics();
+
+	void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+	void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color) override;
+	void DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color) override;
+	void DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color) override;
+	void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color) override;
+	void DrawTransform(const b2Transform& xf) override;
+	void DrawPoint(const b2Vec2& p, float32 size, const b2Color& color) override;
+
+	void clearInstanceData();
+
+	// Records the collected instances into the render queue
+	void draw();
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
+
+private:
+	enum CommandType
+	{
+		COMMAND_DRAW
+	};
+
+	enum Primitive
+	{
+		PRIMITIVE_BOX,
+		PRIMITIVE_CIRCLE,
+		PRIMITIVE_SEGMENT,
+		PRIMITIVE_COUNT
+	};
+
+	// Followed by every primitive's instances, in primitive order
+	struct DrawCommand
+	{
+		unsigned int shaderID;
+		unsigned int instanceCounts[PRIMITIVE_COUNT];
+	};
+
+	void addBox(glm::vec2 min, glm::vec2 max, const b2Color& color);
+	void addSegment(glm::vec2 start, glm::vec2 end, const b2Color& color);
+	bool isVisible(glm::vec2 min, glm::vec2 max) const;
+
+	void executeDraw(const DrawCommand& command);
+	void resizeInstanceBuffer(size_t instanceCapacity);
+
+	static glm::vec2 toWorld(const b2Vec2& vector);
+
+	const Camera& m_camera;
+
+	// Only used by the simulation. The view's bounds are updated when the instance data is cleared.
+	std::vector<DebugDrawInstance> m_instances[PRIMITIVE_COUNT];
+	glm::vec2 m_viewMin;
+	glm::vec2 m_viewMax;
+	unsigned int m_shaderID; // 0 until the shader has loaded, and passed to the render thread with each draw
+
+	// Only used on the render thread once it has started
+	unsigned int m_vao;
+	unsigned int m_vertexBuffer; // Every primitive's mesh, one after the other
+	unsigned int m_instanceBuffer;
+	size_t m_instanceCapacity;
+	int m_meshFirstVertex[PRIMITIVE_COUNT];
+	int m_meshVertexCount[PRIMITIVE_COUNT];
+
+	UploadRingBuffer* m_uploadBuffer;
+};
@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "DebugHUD.h"
+
+#include <chrono>
+
+DebugHUD::DebugHUD(const Terrain& terrain)
+	: m_terrain(terrain), m_frameTimes(), m_nextFrame(0), m_drawTime(0.0f)
+{
+}
+
+void DebugHUD::update(float deltaTime)
+{
+	m_frameTimes[m_nextFrame] = deltaTime * 1000.0f;
+	m_nextFrame = (m_nextFrame + 1) % HUD_FRAME_HISTORY_LENGTH;
+}
+
+void DebugHUD::draw(TextRenderer& textRenderer)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	float averageFrameTime = 0.0f;
+	float maxFrameTime = 0.0f;
+	for (int i = 0; i < HUD_FRAME_HISTORY_LENGTH; i++)
+	{
+		averageFrameTime += m_frameTimes[i];
+		maxFrameTime = std::max(maxFrameTime, m_frameTimes[i]);
+	}
+	averageFrameTime /= HUD_FRAME_HISTORY_LENGTH;
+
+	// Formatted into a fixed buffer, so drawing the HUD doesn't allocate
+	char text[256];
+	snprintf(text, sizeof(text), "Frame: %.2f ms avg, %.2f ms max (%.0f FPS)\nChunks: %zu resident\nGen queue: %zu chunks\nGen threads: %zu in flight\nHUD: %.3f ms",
+		averageFrameTime, maxFrameTime, averageFrameTime > 0.0f ? 1000.0f / averageFrameTime : 0.0f, m_terrain.getResidentChunkCount(),
+		m_terrain.getQueuedGenChunkCount(), m_terrain.getGenThreadCount(), m_drawTime);
+
+	const glm::vec2 margin(8.0f);
+	glm::vec2 textSize = textRenderer.getTextSize(text, HUD_TEXT_SCALE);
+	textRenderer.addRect(glm::vec2(0.0f), textSize + margin * 2.0f, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	textRenderer.addText(text, margin, HUD_TEXT_SCALE);
+
+	// The frame time graph goes under the text, with the oldest frame on the left and a line at the target frame time
+	glm::vec2 graphPosition = glm::vec2(margin.x, textSize.y + margin.y * 3.0f);
+	glm::vec2 graphSize = glm::vec2(HUD_FRAME_HISTORY_LENGTH * 2.0f, HUD_GRAPH_MAX_MS * HUD_GRAPH_PIXELS_PER_MS);
+	float graphBottom = graphPosition.y + graphSize.y;
+
+	textRenderer.addRect(graphPosition, graphSize, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+	for (int i = 0; i < HUD_FRAME_HISTORY_LENGTH; i++)
+	{
+		float frameTime = m_frameTimes[(m_nextFrame + i) % HUD_FRAME_HISTORY_LENGTH];
+		float barHeight = std::min(frameTime, HUD_GRAPH_MAX_MS) * HUD_GRAPH_PIXELS_PER_MS;
+		if (barHeight < 1.0f) continue;
+
+		glm::vec4 color = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+		if (frameTime > HUD_TARGET_FRAME_TIME * 2.0f)
+			color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+		else if (frameTime > HUD_TARGET_FRAME_TIME)
+			color = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+
+		textRenderer.addRect(glm::vec2(graphPosition.x + i * 2.0f, graphBottom - barHeight), glm::vec2(2.0f, barHeight), color);
+	}
+
+	textRenderer.addRect(glm::vec2(graphPosition.x, graphBottom - HUD_TARGET_FRAME_TIME * HUD_GRAPH_PIXELS_PER_MS), glm::vec2(graphSize.x, 1.0f), glm::vec4(1.0f));
+
+	std::chrono::duration<float, std::milli> drawTime = std::chrono::high_resolution_clock::now() - startTime;
+	m_drawTime = drawTime.count();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../TextRenderer.h"
+#include "../Terrain.h"
+
+#define HUD_FRAME_HISTORY_LENGTH 120 // Number of frames shown in the frame time graph
+#define HUD_TEXT_SCALE 2.0f // How many pixels each glyph pixel covers
+#define HUD_GRAPH_PIXELS_PER_MS 2.0f // Height of the frame time graph's bars per millisecond
+#define HUD_GRAPH_MAX_MS 50.0f // Frame times past this are clipped to the top of the graph
+#define HUD_TARGET_FRAME_TIME (1000.0f / 60.0f) // Frame times past this are drawn in yellow, and past twice this in red
+
+// An overlay of frame times and chunk streaming stats, for profiling without leaving the game
+class DebugHUD
+{
+public:
+	DebugHUD(const Terrain& terrain);
+
+	// Called every frame, even when the HUD isn't drawn, so the graph is already full when it's shown
+	void update(float deltaTime);
+
+	void draw(TextRenderer& textRenderer);
+
+private:
+	const Terrain& m_terrain;
+
+	float m_frameTimes[HUD_FRAME_HISTORY_LENGTH]; // In milliseconds
+	size_t m_nextFrame; // The slot the next frame time is written to
+
+	float m_drawTime; // How long the last draw took in milliseconds, shown on the next one
+};
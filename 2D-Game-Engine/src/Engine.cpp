@@ -10,27 +10,39 @@ Engine::Engine(int width, int height)
 
 	m_assetManager = new AssetManager();
 
+	// Keep the shaders' constants in sync with the engine's. These are added first, since the systems load shaders as they're constructed.
+	m_assetManager->addShaderDefine("BLOCK_SIZE", BLOCK_SIZE);
+	m_assetManager->addShaderDefine("CHUNK_SIZE", CHUNK_SIZE);
+	m_assetManager->addShaderDefine("MAX_ANIMATION_LENGTH", MAX_ANIMATION_LENGTH);
+	m_assetManager->addShaderDefine("CAMERA_UNIFORM_BUFFER_BINDING", CAMERA_UNIFORM_BUFFER_BINDING);
+	m_assetManager->addShaderDefine("GLYPH_ATLAS_COLUMNS", GLYPH_ATLAS_COLUMNS);
+	m_assetManager->addShaderDefine("GLYPH_ATLAS_ROWS", GLYPH_ATLAS_ROWS);
+
 	// Construct the systems
 	m_transformSystem = new TransformSystem();
 	m_renderSystem = new RendererSystem();
 	m_physicsSystem = new PhysicsSystem();
+	m_particleSystem = new ParticleSystem(m_renderSystem->getVertexBufferID(), m_renderSystem->getIndexBufferID());
+	m_textRenderer = new TextRenderer(width, height, m_renderSystem->getVertexBufferID(), m_renderSystem->getIndexBufferID());
 
 	// Call the blocks constructor to initialize all the blocks
 	BlockContainer blocks;
 
 	m_camera = new Camera(width, height);
-	m_terrain = new Terrain(m_physicsSystem->getWorld(), m_camera->getPosition(), m_renderSystem->getVertexBufferID(), m_renderSystem->getIndexBufferID());
+	m_terrain = new Terrain(m_physicsSystem->getWorld(), *m_camera, m_renderSystem->getIndexBufferID());
+
+	// The camera keeps the chunks around it loaded
+	m_cameraObserverID = m_terrain->addObserver(m_camera->getPosition(), m_camera->getViewSize());
 
 	// Create player
 	AssetManager* assetManager = AssetManager::getInstance();
-	unsigned int playerTextureID = assetManager->loadTexture("player", "textures/player.png");
-	unsigned int defaultShaderID = assetManager->getShader("defaultShader");
+	unsigned int defaultShaderID = assetManager->getShader(ASSET_ID("defaultShader"));
 
 	size_t playerID = 1;
 	m_playerController = new PlayerController(playerID);
 
 	TransformSystem::getInstance()->addComponent(playerID, glm::vec2(), glm::vec2(32, 64));
-	RendererSystem::getInstance()->addComponent(playerID, Texture(glm::vec2(32, 64), playerTextureID), glm::vec2(32, 64), defaultShaderID, 0, nullptr);
+	RendererSystem::getInstance()->addComponent(playerID, Texture(), glm::vec2(32, 64), defaultShaderID, 0, nullptr);
 	
 	size_t playerPhysicsObjectIndex = PhysicsSystem::getInstance()->addComponent(playerID, glm::vec2(), glm::vec2(32, 64), b2_dynamicBody);
 	PhysicsSystem::getInstance()->addFixture(playerID, playerPhysicsObjectIndex, glm::vec2(0, -32), glm::vec2(32, 4), true,
@@ -42,22 +54,33 @@ Engine::Engine(int width, int height)
 	// TEMP
 	size_t tempID = 2;
 	TransformSystem::getInstance()->addComponent(tempID, glm::vec2(0, -100), glm::vec2(2048, 64));
-	RendererSystem::getInstance()->addComponent(tempID, Texture(glm::vec2(32, 64), playerTextureID), glm::vec2(32, 64), defaultShaderID, 0, nullptr);
+	RendererSystem::getInstance()->addComponent(tempID, Texture(), glm::vec2(32, 64), defaultShaderID, 0, nullptr);
 	
 	size_t tempPhysicsObjectIndex = PhysicsSystem::getInstance()->addComponent(tempID, glm::vec2(0, -100), glm::vec2(2048, 64), b2_kinematicBody);
 	PhysicsSystem::getInstance()->addFixture(tempID, tempPhysicsObjectIndex, glm::vec2(), glm::vec2(2048, 64));
 
+	// Nothing waits on the player's texture, so it loads in the background and the sprites appear once it's ready
+	assetManager->loadTextureAsync("player", "textures/player.png", glm::vec2(), [playerID, tempID](const Texture& texture)
+	{
+		RendererSystem::getInstance()->setTexture(playerID, texture);
+		RendererSystem::getInstance()->setTexture(tempID, texture);
+	});
+
 #ifdef _DEBUG
 	m_debugDraw = new DebugDrawPhysics(*m_camera);
 	m_debugDraw->SetFlags(b2Draw::e_shapeBit);
 	m_physicsSystem->setDebugDraw(m_debugDraw);
 	m_shouldDrawDebugPhysics = false;
+
+	m_debugHUD = new DebugHUD(*m_terrain);
+	m_shouldDrawDebugHUD = false;
 #endif 
 }
 
 Engine::~Engine()
 {
 #ifdef _DEBUG
+	delete m_debugHUD;
 	delete m_debugDraw;
 #endif 
 
@@ -65,6 +88,8 @@ Engine::~Engine()
 	delete m_terrain;
 	delete m_camera;
 	delete m_physicsSystem;
+	delete m_textRenderer;
+	delete m_particleSystem;
 	delete m_renderSystem;
 	delete m_transformSystem;
 	delete m_assetManager;
@@ -72,28 +97,79 @@ Engine::~Engine()
 
 void Engine::update(float deltaTime)
 {
+	m_assetManager->update();
+
 	m_playerController->update(deltaTime);
 
+	// The player's velocity is used to prefetch chunks in the direction of travel
+	glm::vec2 playerVelocity = m_physicsSystem->getVelocity(m_playerController->getPlayerID());
+	m_terrain->updateObserver(m_cameraObserverID, m_camera->getPosition(), m_camera->getViewSize(), playerVelocity);
+
 	m_terrain->cameraUpdate(*m_camera);
-	m_terrain->update();
+	m_terrain->update(deltaTime);
 
 	m_physicsSystem->update();
+	m_particleSystem->update(deltaTime);
 
 #ifdef _DEBUG
 	if (Input::getInstance()->isKeyPressed(GLFW_KEY_Q))
 	{
 		m_shouldDrawDebugPhysics = !m_shouldDrawDebugPhysics;
 	}
+
+	m_debugHUD->update(deltaTime);
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_H))
+		m_shouldDrawDebugHUD = !m_shouldDrawDebugHUD;
+
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_C))
+	{
+		const CullStats& spriteStats = m_renderSystem->getLastFrameCullStats();
+		const CullStats& terrainStats = m_terrain->getLastFrameCullStats();
+		Output::log("Sprites: " + std::to_string(spriteStats.drawnCount) + " drawn, " + std::to_string(spriteStats.culledCount) + " culled. Chunk containers: " +
+			std::to_string(terrainStats.drawnCount) + " drawn, " + std::to_string(terrainStats.culledCount) + " culled");
+	}
+
+	// Dump the render stats, so regressions in what's submitted each frame show up in the log and in a spreadsheet
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_P))
+	{
+		const RenderStats& renderStats = GraphicsDevice::getInstance()->getStats();
+		Output::log(renderStats.getSummary());
+		if (renderStats.writeHistory(RENDER_STATS_DUMP_FILEPATH))
+			Output::log("Wrote the render stats history to " + std::string(RENDER_STATS_DUMP_FILEPATH));
+	}
+
+	// Fill the screen and its surroundings with particles to profile the particle system under load
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_B))
+		m_particleSystem->spawnBenchmark(m_camera->getPosition());
+
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_N))
+	{
+		const ParticleStats& particleStats = m_particleSystem->getLastFrameStats();
+		Output::log("Particles: " + std::to_string(particleStats.particleCount) + " live, " + std::to_string(particleStats.drawnCount) + " drawn. Update: " +
+			std::to_string(particleStats.updateTime) + "ms, record: " + std::to_string(particleStats.recordTime) + "ms");
+	}
+
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_EQUAL))
+		m_camera->setZoom(m_camera->getZoom() * 2.0f);
+
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_MINUS))
+		m_camera->setZoom(m_camera->getZoom() * 0.5f);
 #endif
 
-	glClear(GL_COLOR_BUFFER_BIT);
+	m_renderSystem->clear();
 
 	const Transform* playerTransform = TransformSystem::getInstance()->getComponent(m_playerController->getPlayerID());
 	if (playerTransform)
 		m_camera->translate(playerTransform->position - m_camera->getPosition());
-	
+
+	checkRebaseOrigin();
+
+	// Every shader reads the camera from the same uniform buffer, uploaded once for the frame
+	m_renderSystem->uploadCamera(*m_camera);
+
 	m_terrain->render(*m_camera);
 	m_renderSystem->render(*m_camera);
+	m_particleSystem->render(*m_camera);
 
 #ifdef _DEBUG
 	if (m_shouldDrawDebugPhysics)
@@ -102,10 +178,40 @@ void Engine::update(float deltaTime)
 		m_physicsSystem->drawDebugData();
 		m_debugDraw->draw();
 	}
+
+	// Drawn last so it's on top of everything
+	if (m_shouldDrawDebugHUD)
+		m_debugHUD->draw(*m_textRenderer);
 #endif
+
+	m_textRenderer->render();
+}
+
+void Engine::checkRebaseOrigin()
+{
+	// Floats lose precision far from the origin, so once the camera gets far enough away the whole world
+	// is moved back around it. The world is only a few chunks tall, so only the x axis needs to be rebased.
+	float cameraX = m_camera->getPosition().x;
+	if (fabsf(cameraX) < FLOATING_ORIGIN_REBASE_DISTANCE) return;
+
+	// Shift by whole chunks so the chunks stay aligned to the origin
+	float chunkWorldSize = CHUNK_SIZE * BLOCK_SIZE;
+	ChunkCoords chunkDelta((int64_t)floorf(cameraX / chunkWorldSize), 0);
+	glm::vec2 worldDelta = glm::vec2(chunkDelta.x * chunkWorldSize, 0.0f);
+
+	m_terrain->shiftOrigin(chunkDelta);
+	m_physicsSystem->shiftOrigin(worldDelta);
+	m_transformSystem->shiftOrigin(worldDelta);
+	m_particleSystem->shiftOrigin(worldDelta);
+	m_camera->translate(-worldDelta);
+
+	ChunkCoords originChunk = m_terrain->getOriginChunk();
+	Output::log("Rebased the world origin to chunk X: " + std::to_string(originChunk.x) + ", Y: " + std::to_string(originChunk.y));
 }
 
 void Engine::onWindowResize(int width, int height)
 {
 	m_camera->resize(width, height);
+	m_renderSystem->setViewport(width, height);
+	m_textRenderer->setScreenSize(width, height);
 }
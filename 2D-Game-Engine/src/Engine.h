@@ -1,10 +1,15 @@
 #pragma once
 
 #include "AssetManager.h"
+#include "ParticleSystem.h"
+#include "TextRenderer.h"
+#include "Debug/DebugHUD.h"
 #include "Systems/Systems.h"
 #include "Terrain.h"
 #include "PlayerController.h"
 
+#define FLOATING_ORIGIN_REBASE_DISTANCE 65536.0f // How far in pixels the camera can get from the origin horizontally before the world is shifted back around it
+
 class Engine
 {
 public:
@@ -16,16 +21,25 @@ public:
 	void onWindowResize(int width, int height);
 
 private:
+	void checkRebaseOrigin();
+
 	AssetManager* m_assetManager;
 	TransformSystem* m_transformSystem;
 	RendererSystem* m_renderSystem;
+	ParticleSystem* m_particleSystem;
+	TextRenderer* m_textRenderer;
 	PhysicsSystem* m_physicsSystem;
 	Terrain* m_terrain;
 	Camera* m_camera;
 	PlayerController* m_playerController;
 
+	size_t m_cameraObserverID;
+
 #ifdef _DEBUG
 	DebugDrawPhysics* m_debugDraw;
 	bool m_shouldDrawDebugPhysics;
+
+	DebugHUD* m_debugHUD;
+	bool m_shouldDrawDebugHUD;
 #endif 
 };
\ No newline at end of file
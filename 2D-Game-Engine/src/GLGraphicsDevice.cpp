@@ -0,0 +1,299 @@
+#include "stdafx.h"
+#include "GLGraphicsDevice.h"
+
+unsigned int GLGraphicsDevice::createTexture(unsigned int width, unsigned int height, bool hasAlpha, const void* data)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	if (hasAlpha)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, data);
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+
+	return texture;
+}
+
+void GLGraphicsDevice::updateTexture(unsigned int texture, int x, int y, int width, int height, const void* data)
+{
+	increment(RENDER_COUNTER_UPLOAD_BYTES, (size_t)width * height * 4);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_BGRA, GL_UNSIGNED_BYTE, data);
+}
+
+void GLGraphicsDevice::deleteTexture(unsigned int texture)
+{
+	glDeleteTextures(1, &texture);
+}
+
+unsigned int GLGraphicsDevice::createShader(unsigned int shaderType, const std::string& source, std::string& errorLog)
+{
+	const char* sourceBuffer = source.c_str();
+
+	unsigned int shader = glCreateShader(shaderType);
+	glShaderSource(shader, 1, &sourceBuffer, nullptr);
+	glCompileShader(shader);
+
+	int success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+	if (!success)
+	{
+		int errorLogLength;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &errorLogLength);
+
+		char* errorBuffer = new char[errorLogLength];
+		glGetShaderInfoLog(shader, errorLogLength, &errorLogLength, errorBuffer);
+		errorLog = std::string(errorBuffer);
+		delete[] errorBuffer;
+
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+void GLGraphicsDevice::deleteShader(unsigned int shader)
+{
+	glDeleteShader(shader);
+}
+
+unsigned int GLGraphicsDevice::createProgram(unsigned int vertexShader, unsigned int fragmentShader, std::string& errorLog)
+{
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+	if (!success)
+	{
+		int errorLogLength;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &errorLogLength);
+
+		char* errorBuffer = new char[errorLogLength];
+		glGetProgramInfoLog(program, errorLogLength, &errorLogLength, errorBuffer);
+		errorLog = std::string(errorBuffer);
+		delete[] errorBuffer;
+
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void GLGraphicsDevice::deleteProgram(unsigned int program)
+{
+	glDeleteProgram(program);
+}
+
+unsigned int GLGraphicsDevice::createBuffer()
+{
+	unsigned int buffer;
+	glGenBuffers(1, &buffer);
+	return buffer;
+}
+
+void GLGraphicsDevice::deleteBuffer(unsigned int buffer)
+{
+	glDeleteBuffers(1, &buffer);
+}
+
+void GLGraphicsDevice::bindBuffer(unsigned int target, unsigned int buffer)
+{
+	glBindBuffer(target, buffer);
+}
+
+void GLGraphicsDevice::bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glBindBufferBase(target, index, buffer);
+}
+
+void GLGraphicsDevice::bufferData(unsigned int target, size_t size, const void* data, unsigned int usage)
+{
+	if (data)
+		increment(RENDER_COUNTER_UPLOAD_BYTES, size);
+
+	glBufferData(target, size, data, usage);
+}
+
+void GLGraphicsDevice::bufferSubData(unsigned int target, size_t offset, size_t size, const void* data)
+{
+	increment(RENDER_COUNTER_UPLOAD_BYTES, size);
+	glBufferSubData(target, offset, size, data);
+}
+
+void GLGraphicsDevice::copyBufferSubData(unsigned int readTarget, unsigned int writeTarget, size_t readOffset, size_t writeOffset, size_t size)
+{
+	increment(RENDER_COUNTER_COPY_BYTES, size);
+	glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+}
+
+void* GLGraphicsDevice::mapPersistentBuffer(unsigned int target, size_t size)
+{
+	if (!GLEW_ARB_buffer_storage) return nullptr;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glBufferStorage(target, size, nullptr, flags);
+	return glMapBufferRange(target, 0, size, flags);
+}
+
+void GLGraphicsDevice::unmapBuffer(unsigned int target)
+{
+	glUnmapBuffer(target);
+}
+
+GLsync GLGraphicsDevice::fenceSync()
+{
+	return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLenum GLGraphicsDevice::clientWaitSync(GLsync fence, bool flush, uint64_t timeout)
+{
+	return glClientWaitSync(fence, flush ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+}
+
+void GLGraphicsDevice::deleteSync(GLsync fence)
+{
+	glDeleteSync(fence);
+}
+
+unsigned int GLGraphicsDevice::createVertexArray()
+{
+	unsigned int vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	return vertexArray;
+}
+
+void GLGraphicsDevice::deleteVertexArray(unsigned int vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+void GLGraphicsDevice::bindVertexArray(unsigned int vertexArray)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glBindVertexArray(vertexArray);
+}
+
+void GLGraphicsDevice::enableVertexAttribArray(unsigned int index)
+{
+	glEnableVertexAttribArray(index);
+}
+
+void GLGraphicsDevice::vertexAttribPointer(unsigned int index, int size, unsigned int type, bool normalized, int stride, size_t offset)
+{
+	glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride, (void*)offset);
+}
+
+void GLGraphicsDevice::vertexAttribIPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset)
+{
+	glVertexAttribIPointer(index, size, type, stride, (void*)offset);
+}
+
+void GLGraphicsDevice::vertexAttribDivisor(unsigned int index, unsigned int divisor)
+{
+	glVertexAttribDivisor(index, divisor);
+}
+
+void GLGraphicsDevice::useProgram(unsigned int program)
+{
+	increment(RENDER_COUNTER_PROGRAM_BINDS);
+	glUseProgram(program);
+}
+
+void GLGraphicsDevice::bindTexture(unsigned int texture)
+{
+	increment(RENDER_COUNTER_TEXTURE_BINDS);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLGraphicsDevice::uniform1i(int location, int value)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(int));
+	glUniform1i(location, value);
+}
+
+void GLGraphicsDevice::uniform1f(int location, float value)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float));
+	glUniform1f(location, value);
+}
+
+void GLGraphicsDevice::uniform2f(int location, float x, float y)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float) * 2);
+	glUniform2f(location, x, y);
+}
+
+void GLGraphicsDevice::uniform4f(int location, float x, float y, float z, float w)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float) * 4);
+	glUniform4f(location, x, y, z, w);
+}
+
+void GLGraphicsDevice::enable(unsigned int capability)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glEnable(capability);
+}
+
+void GLGraphicsDevice::disable(unsigned int capability)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glDisable(capability);
+}
+
+void GLGraphicsDevice::blendFunc(unsigned int sourceFactor, unsigned int destinationFactor)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLGraphicsDevice::clearColor(float red, float green, float blue, float alpha)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glClearColor(red, green, blue, alpha);
+}
+
+void GLGraphicsDevice::clear(unsigned int mask)
+{
+	glClear(mask);
+}
+
+void GLGraphicsDevice::viewport(int x, int y, int width, int height)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+	glViewport(x, y, width, height);
+}
+
+void GLGraphicsDevice::drawArraysInstancedBaseInstance(unsigned int mode, int first, int count, int instanceCount, unsigned int baseInstance)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	countDraw(mode, count, instanceCount);
+	glDrawArraysInstancedBaseInstance(mode, first, count, instanceCount, baseInstance);
+}
+
+void GLGraphicsDevice::drawElementsInstancedBaseInstance(unsigned int mode, int count, unsigned int type, size_t indexOffset, int instanceCount, unsigned int baseInstance)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	countDraw(mode, count, instanceCount);
+	glDrawElementsInstancedBaseInstance(mode, count, type, (void*)indexOffset, instanceCount, baseInstance);
+}
+
+void GLGraphicsDevice::multiDrawElementsIndirect(unsigned int mode, unsigned int type, size_t indirectOffset, int drawCount, int stride)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	increment(RENDER_COUNTER_DRAWS, drawCount);
+	glMultiDrawElementsIndirect(mode, type, (void*)indirectOffset, drawCount, stride);
+}
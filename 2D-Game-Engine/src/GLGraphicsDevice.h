@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GraphicsDevice.h"
+
+// Submits everything to the current GL context
+class GLGraphicsDevice : public GraphicsDevice
+{
+public:
+	unsigned int createTexture(unsigned int width, unsigned int height, bool hasAlpha, const void* data) override;
+	void updateTexture(unsigned int texture, int x, int y, int width, int height, const void* data) override;
+	void deleteTexture(unsigned int texture) override;
+	unsigned int createShader(unsigned int shaderType, const std::string& source, std::string& errorLog) override;
+	void deleteShader(unsigned int shader) override;
+	unsigned int createProgram(unsigned int vertexShader, unsigned int fragmentShader, std::string& errorLog) override;
+	void deleteProgram(unsigned int program) override;
+
+	unsigned int createBuffer() override;
+	void deleteBuffer(unsigned int buffer) override;
+	void bindBuffer(unsigned int target, unsigned int buffer) override;
+	void bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer) override;
+	void bufferData(unsigned int target, size_t size, const void* data, unsigned int usage) override;
+	void bufferSubData(unsigned int target, size_t offset, size_t size, const void* data) override;
+	void copyBufferSubData(unsigned int readTarget, unsigned int writeTarget, size_t readOffset, size_t writeOffset, size_t size) override;
+
+	void* mapPersistentBuffer(unsigned int target, size_t size) override;
+	void unmapBuffer(unsigned int target) override;
+	GLsync fenceSync() override;
+	GLenum clientWaitSync(GLsync fence, bool flush, uint64_t timeout) override;
+	void deleteSync(GLsync fence) override;
+
+	unsigned int createVertexArray() override;
+	void deleteVertexArray(unsigned int vertexArray) override;
+	void bindVertexArray(unsigned int vertexArray) override;
+	void enableVertexAttribArray(unsigned int index) override;
+	void vertexAttribPointer(unsigned int index, int size, unsigned int type, bool normalized, int stride, size_t offset) override;
+	void vertexAttribIPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) override;
+	void vertexAttribDivisor(unsigned int index, unsigned int divisor) override;
+
+	void useProgram(unsigned int program) override;
+	void bindTexture(unsigned int texture) override;
+	void uniform1i(int location, int value) override;
+	void uniform1f(int location, float value) override;
+	void uniform2f(int location, float x, float y) override;
+	void uniform4f(int location, float x, float y, float z, float w) override;
+	void enable(unsigned int capability) override;
+	void disable(unsigned int capability) override;
+	void blendFunc(unsigned int sourceFactor, unsigned int destinationFactor) override;
+	void clearColor(float red, float green, float blue, float alpha) override;
+	void clear(unsigned int mask) override;
+	void viewport(int x, int y, int width, int height) override;
+
+	void drawArraysInstancedBaseInstance(unsigned int mode, int first, int count, int instanceCount, unsigned int baseInstance) override;
+	void drawElementsInstancedBaseInstance(unsigned int mode, int count, unsigned int type, size_t indexOffset, int instanceCount, unsigned int baseInstance) override;
+	void multiDrawElementsIndirect(unsigned int mode, unsigned int type, size_t indirectOffset, int drawCount, int stride) override;
+};
@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include "GraphicsDevice.h"
+
+GraphicsDevice* GraphicsDevice::m_instance = nullptr;
+
+GraphicsDevice::GraphicsDevice()
+	: m_renderPass(RENDER_PASS_FRAME)
+{
+	if (!m_instance)
+		m_instance = this;
+	else
+	{
+		Output::error("Attempted to create a second GraphicsDevice instance - this is not supported. Use GraphicsDevice::getInstance() instead.");
+		exit(EXIT_FAILURE);
+	}
+}
+
+GraphicsDevice::~GraphicsDevice()
+{
+	m_instance = nullptr;
+}
+
+GraphicsDevice* GraphicsDevice::getInstance()
+{
+	return m_instance;
+}
+
+void GraphicsDevice::setRenderPass(RenderPass pass)
+{
+	m_renderPass = pass;
+}
+
+void GraphicsDevice::countIndirectDraws(size_t instanceCount, size_t triangleCount)
+{
+	increment(RENDER_COUNTER_INSTANCES, instanceCount);
+	increment(RENDER_COUNTER_TRIANGLES, triangleCount);
+}
+
+void GraphicsDevice::countMappedUpload(size_t size)
+{
+	increment(RENDER_COUNTER_UPLOAD_BYTES, size);
+}
+
+void GraphicsDevice::endFrame()
+{
+	m_stats.addFrame(m_frameCounters);
+
+	for (int i = 0; i < RENDER_PASS_COUNT; i++)
+	{
+		m_frameCounters[i] = RenderCounters();
+	}
+
+	m_renderPass = RENDER_PASS_FRAME;
+}
+
+const RenderStats& GraphicsDevice::getStats() const
+{
+	return m_stats;
+}
+
+void GraphicsDevice::increment(RenderCounter counter, size_t amount)
+{
+	m_frameCounters[m_renderPass].values[counter] += amount;
+}
+
+void GraphicsDevice::countDraw(unsigned int mode, int vertexCount, int instanceCount)
+{
+	increment(RENDER_COUNTER_DRAWS);
+	increment(RENDER_COUNTER_INSTANCES, instanceCount);
+
+	if (mode == GL_TRIANGLES)
+		increment(RENDER_COUNTER_TRIANGLES, (size_t)(vertexCount / 3) * instanceCount);
+}
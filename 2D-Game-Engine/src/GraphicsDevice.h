@@ -0,0 +1,99 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+#include "RenderStats.h"
+
+// Everything the renderers submit to the GPU goes through this, so they can run on a real GL context or without one.
+// The functions are thin wrappers around their GL equivalents and take the same enums, except that objects are created
+// and deleted one at a time. Every implementation counts what's submitted to it into the render stats, by render pass.
+class GraphicsDevice
+{
+public:
+	GraphicsDevice();
+	virtual ~GraphicsDevice();
+
+	static GraphicsDevice* getInstance();
+
+	// Textures and shaders. Texture data is BGR or BGRA, as it's loaded by FreeImage. The error log is filled in when creation fails and 0 is returned.
+	virtual unsigned int createTexture(unsigned int width, unsigned int height, bool hasAlpha, const void* data) = 0;
+	virtual void updateTexture(unsigned int texture, int x, int y, int width, int height, const void* data) = 0; // Data is always BGRA, or an offset into the bound pixel unpack buffer
+	virtual void deleteTexture(unsigned int texture) = 0;
+	virtual unsigned int createShader(unsigned int shaderType, const std::string& source, std::string& errorLog) = 0;
+	virtual void deleteShader(unsigned int shader) = 0;
+	virtual unsigned int createProgram(unsigned int vertexShader, unsigned int fragmentShader, std::string& errorLog) = 0;
+	virtual void deleteProgram(unsigned int program) = 0;
+
+	// Buffers
+	virtual unsigned int createBuffer() = 0;
+	virtual void deleteBuffer(unsigned int buffer) = 0;
+	virtual void bindBuffer(unsigned int target, unsigned int buffer) = 0;
+	virtual void bindBufferBase(unsigned int target, unsigned int index, unsigned int buffer) = 0;
+	virtual void bufferData(unsigned int target, size_t size, const void* data, unsigned int usage) = 0;
+	virtual void bufferSubData(unsigned int target, size_t offset, size_t size, const void* data) = 0;
+	virtual void copyBufferSubData(unsigned int readTarget, unsigned int writeTarget, size_t readOffset, size_t writeOffset, size_t size) = 0;
+
+	// Persistently mapped buffers and fences. mapPersistentBuffer gives the buffer bound to the target immutable storage
+	// and maps it for coherent writes, and returns nullptr when that isn't supported.
+	virtual void* mapPersistentBuffer(unsigned int target, size_t size) = 0;
+	virtual void unmapBuffer(unsigned int target) = 0;
+	virtual GLsync fenceSync() = 0;
+	virtual GLenum clientWaitSync(GLsync fence, bool flush, uint64_t timeout) = 0;
+	virtual void deleteSync(GLsync fence) = 0;
+
+	// Vertex arrays
+	virtual unsigned int createVertexArray() = 0;
+	virtual void deleteVertexArray(unsigned int vertexArray) = 0;
+	virtual void bindVertexArray(unsigned int vertexArray) = 0;
+	virtual void enableVertexAttribArray(unsigned int index) = 0;
+	virtual void vertexAttribPointer(unsigned int index, int size, unsigned int type, bool normalized, int stride, size_t offset) = 0;
+	virtual void vertexAttribIPointer(unsigned int index, int size, unsigned int type, int stride, size_t offset) = 0;
+	virtual void vertexAttribDivisor(unsigned int index, unsigned int divisor) = 0;
+
+	// State. Textures are always 2D.
+	virtual void useProgram(unsigned int program) = 0;
+	virtual void bindTexture(unsigned int texture) = 0;
+	virtual void uniform1i(int location, int value) = 0;
+	virtual void uniform1f(int location, float value) = 0;
+	virtual void uniform2f(int location, float x, float y) = 0;
+	virtual void uniform4f(int location, float x, float y, float z, float w) = 0;
+	virtual void enable(unsigned int capability) = 0;
+	virtual void disable(unsigned int capability) = 0;
+	virtual void blendFunc(unsigned int sourceFactor, unsigned int destinationFactor) = 0;
+	virtual void clearColor(float red, float green, float blue, float alpha) = 0;
+	virtual void clear(unsigned int mask) = 0;
+	virtual void viewport(int x, int y, int width, int height) = 0;
+
+	// Drawing
+	virtual void drawArraysInstancedBaseInstance(unsigned int mode, int first, int count, int instanceCount, unsigned int baseInstance) = 0;
+	virtual void drawElementsInstancedBaseInstance(unsigned int mode, int count, unsigned int type, size_t indexOffset, int instanceCount, unsigned int baseInstance) = 0;
+	virtual void multiDrawElementsIndirect(unsigned int mode, unsigned int type, size_t indirectOffset, int drawCount, int stride) = 0;
+
+	// Everything submitted is counted towards this pass until it's changed. Each frame starts in RENDER_PASS_FRAME.
+	void setRenderPass(RenderPass pass);
+
+	// Indirect draws read their instance counts from a GPU buffer, so they're counted by whoever built the draw commands
+	void countIndirectDraws(size_t instanceCount, size_t triangleCount);
+
+	// Writes to persistently mapped buffers don't go through the device, so they're counted by the writer
+	void countMappedUpload(size_t size);
+
+	// Called once a frame has been submitted, on the thread that submits it
+	void endFrame();
+
+	const RenderStats& getStats() const;
+
+protected:
+	void increment(RenderCounter counter, size_t amount = 1);
+	void countDraw(unsigned int mode, int vertexCount, int instanceCount);
+
+private:
+	static GraphicsDevice* m_instance;
+
+	RenderCounters m_frameCounters[RENDER_PASS_COUNT];
+	RenderPass m_renderPass;
+
+	RenderStats m_stats;
+};
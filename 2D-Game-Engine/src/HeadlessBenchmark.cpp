@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include "HeadlessBenchmark.h"
+
+#include "NullGraphicsDevice.h"
+
+#include <chrono>
+
+HeadlessBenchmark::HeadlessBenchmark(int width, int height)
+{
+	// The same order as the window, minus the render thread
+	m_input = new Input();
+	m_graphicsDevice = new NullGraphicsDevice();
+	m_renderQueue = new RenderQueue();
+	m_engine = new Engine(width, height);
+}
+
+HeadlessBenchmark::~HeadlessBenchmark()
+{
+	delete m_engine;
+	delete m_renderQueue;
+	delete m_graphicsDevice;
+	delete m_input;
+}
+
+bool HeadlessBenchmark::run(int frameCount)
+{
+	if (frameCount < RENDER_STATS_HISTORY_LENGTH)
+		Output::report("Only " + std::to_string(frameCount) + " frames were run, so the budgets include startup frames");
+
+	float totalFrameTime = 0.0f;
+	float maxFrameTime = 0.0f;
+
+	for (int i = 0; i < frameCount; i++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		m_engine->update(HEADLESS_BENCHMARK_DELTA_TIME);
+		m_input->update();
+		m_renderQueue->submitFrame();
+
+		std::chrono::duration<float, std::milli> frameTime = std::chrono::high_resolution_clock::now() - startTime;
+		totalFrameTime += frameTime.count();
+		maxFrameTime = std::max(maxFrameTime, frameTime.count());
+	}
+
+	Output::report("Ran " + std::to_string(frameCount) + " headless frames: " + std::to_string(totalFrameTime / std::max(frameCount, 1)) +
+		" ms avg, " + std::to_string(maxFrameTime) + " ms max");
+
+	const RenderStats& renderStats = m_graphicsDevice->getStats();
+	Output::report(renderStats.getSummary());
+
+	RollingRenderCounters totals = renderStats.getRolling();
+
+	// Every budget is checked, so one run reports all of them
+	bool isWithinBudget = true;
+	isWithinBudget &= checkBudget("Max draw calls", (double)totals.max[RENDER_COUNTER_DRAW_CALLS], HEADLESS_BUDGET_MAX_DRAW_CALLS);
+	isWithinBudget &= checkBudget("Max upload bytes", (double)totals.max[RENDER_COUNTER_UPLOAD_BYTES], HEADLESS_BUDGET_MAX_UPLOAD_BYTES);
+	isWithinBudget &= checkBudget("Average upload bytes", totals.average[RENDER_COUNTER_UPLOAD_BYTES], HEADLESS_BUDGET_AVERAGE_UPLOAD_BYTES);
+
+	return isWithinBudget;
+}
+
+bool HeadlessBenchmark::checkBudget(const std::string& name, double value, double budget)
+{
+	if (value > budget)
+	{
+		Output::report("ERROR: " + name + " is " + std::to_string(value) + ", over the budget of " + std::to_string(budget));
+		return false;
+	}
+
+	Output::report(name + ": " + std::to_string(value) + " of " + std::to_string(budget));
+	return true;
+}
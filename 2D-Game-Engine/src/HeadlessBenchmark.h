@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Engine.h"
+#include "GraphicsDevice.h"
+#include "Input.h"
+#include "RenderQueue.h"
+
+#define HEADLESS_BENCHMARK_FRAME_COUNT 600 // Frames run when no count is given. The budgets are checked over the last RENDER_STATS_HISTORY_LENGTH of them, after startup streaming has settled.
+#define HEADLESS_BENCHMARK_DELTA_TIME (1.0f / 60.0f) // Every frame is simulated with the same time step, so runs are comparable
+#define HEADLESS_BENCHMARK_WIDTH 640 // The screen size the engine is built for, matching the window's default
+#define HEADLESS_BENCHMARK_HEIGHT 480
+
+#define HEADLESS_BUDGET_MAX_DRAW_CALLS 16 // The most draw calls any frame may make, summed over every pass
+#define HEADLESS_BUDGET_MAX_UPLOAD_BYTES (1024 * 1024) // The most bytes any frame may upload
+#define HEADLESS_BUDGET_AVERAGE_UPLOAD_BYTES (64 * 1024) // The most bytes frames may upload on average
+
+// Runs the engine without a window or a GPU, for benchmarking the CPU side of rendering and checking its budgets on CI.
+// The null graphics device counts what each frame submits, and since the render queue is never started, each frame is
+// executed as soon as it's submitted.
+class HeadlessBenchmark
+{
+public:
+	HeadlessBenchmark(int width = HEADLESS_BENCHMARK_WIDTH, int height = HEADLESS_BENCHMARK_HEIGHT);
+	~HeadlessBenchmark();
+
+	// Logs the frame times and render stats, and returns false if any budget was exceeded
+	bool run(int frameCount = HEADLESS_BENCHMARK_FRAME_COUNT);
+
+private:
+	static bool checkBudget(const std::string& name, double value, double budget);
+
+	Input* m_input;
+	GraphicsDevice* m_graphicsDevice;
+	RenderQueue* m_renderQueue;
+	Engine* m_engine;
+};
@@ -0,0 +1,203 @@
+#include "stdafx.h"
+#include "NullGraphicsDevice.h"
+
+NullGraphicsDevice::NullGraphicsDevice()
+	: m_nextObjectID(1)
+{
+}
+
+unsigned int NullGraphicsDevice::createTexture(unsigned int, unsigned int, bool, const void*)
+{
+	return m_nextObjectID++;
+}
+
+void NullGraphicsDevice::updateTexture(unsigned int, int, int, int width, int height, const void*)
+{
+	increment(RENDER_COUNTER_UPLOAD_BYTES, (size_t)width * height * 4);
+}
+
+void NullGraphicsDevice::deleteTexture(unsigned int)
+{
+}
+
+unsigned int NullGraphicsDevice::createShader(unsigned int, const std::string&, std::string&)
+{
+	return m_nextObjectID++;
+}
+
+void NullGraphicsDevice::deleteShader(unsigned int)
+{
+}
+
+unsigned int NullGraphicsDevice::createProgram(unsigned int, unsigned int, std::string&)
+{
+	return m_nextObjectID++;
+}
+
+void NullGraphicsDevice::deleteProgram(unsigned int)
+{
+}
+
+unsigned int NullGraphicsDevice::createBuffer()
+{
+	return m_nextObjectID++;
+}
+
+void NullGraphicsDevice::deleteBuffer(unsigned int)
+{
+}
+
+void NullGraphicsDevice::bindBuffer(unsigned int, unsigned int)
+{
+}
+
+void NullGraphicsDevice::bindBufferBase(unsigned int, unsigned int, unsigned int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::bufferData(unsigned int, size_t size, const void* data, unsigned int)
+{
+	if (data)
+		increment(RENDER_COUNTER_UPLOAD_BYTES, size);
+}
+
+void NullGraphicsDevice::bufferSubData(unsigned int, size_t, size_t size, const void*)
+{
+	increment(RENDER_COUNTER_UPLOAD_BYTES, size);
+}
+
+void NullGraphicsDevice::copyBufferSubData(unsigned int, unsigned int, size_t, size_t, size_t size)
+{
+	increment(RENDER_COUNTER_COPY_BYTES, size);
+}
+
+void* NullGraphicsDevice::mapPersistentBuffer(unsigned int, size_t)
+{
+	return nullptr;
+}
+
+void NullGraphicsDevice::unmapBuffer(unsigned int)
+{
+}
+
+GLsync NullGraphicsDevice::fenceSync()
+{
+	return nullptr;
+}
+
+GLenum NullGraphicsDevice::clientWaitSync(GLsync, bool, uint64_t)
+{
+	return GL_ALREADY_SIGNALED;
+}
+
+void NullGraphicsDevice::deleteSync(GLsync)
+{
+}
+
+unsigned int NullGraphicsDevice::createVertexArray()
+{
+	return m_nextObjectID++;
+}
+
+void NullGraphicsDevice::deleteVertexArray(unsigned int)
+{
+}
+
+void NullGraphicsDevice::bindVertexArray(unsigned int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::enableVertexAttribArray(unsigned int)
+{
+}
+
+void NullGraphicsDevice::vertexAttribPointer(unsigned int, int, unsigned int, bool, int, size_t)
+{
+}
+
+void NullGraphicsDevice::vertexAttribIPointer(unsigned int, int, unsigned int, int, size_t)
+{
+}
+
+void NullGraphicsDevice::vertexAttribDivisor(unsigned int, unsigned int)
+{
+}
+
+void NullGraphicsDevice::useProgram(unsigned int)
+{
+	increment(RENDER_COUNTER_PROGRAM_BINDS);
+}
+
+void NullGraphicsDevice::bindTexture(unsigned int)
+{
+	increment(RENDER_COUNTER_TEXTURE_BINDS);
+}
+
+void NullGraphicsDevice::uniform1i(int, int)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(int));
+}
+
+void NullGraphicsDevice::uniform1f(int, float)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float));
+}
+
+void NullGraphicsDevice::uniform2f(int, float, float)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float) * 2);
+}
+
+void NullGraphicsDevice::uniform4f(int, float, float, float, float)
+{
+	increment(RENDER_COUNTER_UNIFORM_BYTES, sizeof(float) * 4);
+}
+
+void NullGraphicsDevice::enable(unsigned int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::disable(unsigned int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::blendFunc(unsigned int, unsigned int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::clearColor(float, float, float, float)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::clear(unsigned int)
+{
+}
+
+void NullGraphicsDevice::viewport(int, int, int, int)
+{
+	increment(RENDER_COUNTER_STATE_CHANGES);
+}
+
+void NullGraphicsDevice::drawArraysInstancedBaseInstance(unsigned int mode, int, int count, int instanceCount, unsigned int)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	countDraw(mode, count, instanceCount);
+}
+
+void NullGraphicsDevice::drawElementsInstancedBaseInstance(unsigned int mode, int count, unsigned int, size_t, int instanceCount, unsigned int)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	countDraw(mode, count, instanceCount);
+}
+
+void NullGraphicsDevice::multiDrawElementsIndirect(unsigned int, unsigned int, size_t, int drawCount, int)
+{
+	increment(RENDER_COUNTER_DRAW_CALLS);
+	increment(RENDER_COUNTER_DRAWS, drawCount);
+}
@@ -17,3 +17,8 @@ void Output::error(std::string message)
 	__debugbreak();
 #endif
 }
+
+void Output::report(std::string message)
+{
+	std::cout << message << std::endl;
+}
@@ -6,4 +6,7 @@ namespace Output
 {
 	void log(std::string message);
 	void error(std::string message);
+
+	// Printed in every build and never breaks, for results read by scripts such as the headless benchmark's
+	void report(std::string message);
 }
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include "stdafx.h"
+#include "ParticleSystem.h"
+
+#include <chrono>
+
+#include "AssetManager.h"
+#include "GraphicsDevice.h"
+#include "UploadRingBuffer.h"
+#include "Systems/RenderSystem.h"
+
+ParticleSystem* ParticleSystem::m_instance = nullptr;
+
+ParticleSystem::ParticleSystem(unsigned int quadVertexBufferID, unsigned int quadIndexBufferID)
+	: m_nextEmitterID(0), m_randomState(0x9E3779B9), m_instanceBuffer(0), m_instanceCapacity(0)
+{
+	if (!m_instance)
+		m_instance = this;
+	else
+	{
+		Output::error("Attempted to create a second ParticleSystem instance - this is not supported. Use ParticleSystem::getInstance() instead.");
+		exit(EXIT_FAILURE);
+	}
+
+	// Particles are simulated while the shader loads, and drawn once it's ready
+	m_shaderID = 0;
+	AssetManager::getInstance()->loadShaderAsync("particleShader", "shaders/particleVertexShader.glsl", "shaders/fragmentShader.glsl", [this](unsigned int shaderID)
+	{
+		m_shaderID = shaderID;
+	});
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	// Particles are quads, so they're drawn with the renderer system's quad
+	m_vao = device->createVertexArray();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, quadVertexBufferID);
+	device->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBufferID);
+
+	device->enableVertexAttribArray(0);
+	device->vertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex), 0);
+
+	device->enableVertexAttribArray(1);
+	device->vertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(Vertex), sizeof(float) * 2);
+
+	m_instanceBuffer = device->createBuffer();
+	resizeInstanceBuffer(PARTICLE_POOL_INITIAL_CAPACITY);
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer = new UploadRingBuffer(PARTICLE_UPLOAD_RING_BUFFER_SIZE);
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	delete m_uploadBuffer;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->deleteBuffer(m_instanceBuffer);
+	device->deleteVertexArray(m_vao);
+
+	m_instance = nullptr;
+}
+
+ParticleSystem* ParticleSystem::getInstance()
+{
+	return m_instance;
+}
+
+size_t ParticleSystem::addEmitter(const ParticleEmitter& emitter, glm::vec2 position)
+{
+	ActiveEmitter activeEmitter;
+	activeEmitter.emitter = emitter;
+	activeEmitter.position = position;
+	activeEmitter.age = 0.0f;
+	activeEmitter.spawnDebt = 0.0f;
+
+	size_t emitterID = m_nextEmitterID++;
+	m_emitters[emitterID] = activeEmitter;
+
+	return emitterID;
+}
+
+void ParticleSystem::moveEmitter(size_t emitterID, glm::vec2 position)
+{
+	auto it = m_emitters.find(emitterID);
+	if (it != m_emitters.end())
+		it->second.position = position;
+}
+
+void ParticleSystem::removeEmitter(size_t emitterID)
+{
+	// Emitters with a duration remove themselves, so they may already be gone
+	m_emitters.erase(emitterID);
+}
+
+void ParticleSystem::burst(const ParticleEmitter& emitter, glm::vec2 position, size_t count)
+{
+	spawn(getPool(emitter), emitter, position, count);
+}
+
+void ParticleSystem::update(float deltaTime)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (auto it = m_emitters.begin(); it != m_emitters.end();)
+	{
+		ActiveEmitter& activeEmitter = it->second;
+		const ParticleEmitter& emitter = activeEmitter.emitter;
+
+		// Emitters that spawn less than one particle a frame carry the remainder over, so the rate is still met
+		activeEmitter.spawnDebt += emitter.rate * deltaTime;
+		size_t spawnCount = (size_t)activeEmitter.spawnDebt;
+		activeEmitter.spawnDebt -= spawnCount;
+
+		if (spawnCount > 0)
+			spawn(getPool(emitter), emitter, activeEmitter.position, spawnCount);
+
+		activeEmitter.age += deltaTime;
+		if (emitter.duration >= 0.0f && activeEmitter.age >= emitter.duration)
+			it = m_emitters.erase(it);
+		else
+			it++;
+	}
+
+	size_t particleCount = 0;
+	for (size_t i = 0; i < m_pools.size(); i++)
+	{
+		integrate(m_pools[i], deltaTime);
+		removeDead(m_pools[i]);
+
+		particleCount += m_pools[i].count;
+	}
+
+	std::chrono::duration<float, std::milli> updateTime = std::chrono::high_resolution_clock::now() - startTime;
+	m_stats.updateTime = updateTime.count();
+	m_stats.particleCount = particleCount;
+}
+
+void ParticleSystem::render(const Camera& camera)
+{
+	if (m_shaderID == 0) return;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Space is recorded for every live particle, but only the ones on screen are written
+	size_t particleCount = getParticleCount();
+	size_t extraDataSize = sizeof(ParticleBatch) * m_pools.size() + sizeof(ParticleInstance) * particleCount;
+	DrawCommand* command = RenderQueue::getInstance()->record<DrawCommand>(this, COMMAND_DRAW, extraDataSize);
+	command->shaderID = m_shaderID;
+
+	ParticleBatch* batches = reinterpret_cast<ParticleBatch*>(command + 1);
+	ParticleInstance* instances = reinterpret_cast<ParticleInstance*>(batches + m_pools.size());
+
+	glm::vec2 viewPosition = camera.getViewPosition();
+	glm::vec2 viewSize = camera.getViewSize();
+
+	// Every pool gets a batch, even when none of its particles are on screen
+	unsigned int instanceCount = 0;
+	for (size_t i = 0; i < m_pools.size(); i++)
+	{
+		const ParticlePool& pool = m_pools[i];
+
+		ParticleBatch& batch = batches[i];
+		batch.textureID = pool.textureID;
+		batch.uvOffsetScaleFactor = pool.uvOffsetScaleFactor;
+		batch.firstInstance = instanceCount;
+
+		for (size_t j = 0; j < pool.count; j++)
+		{
+			// Particles shrink away over their lifetime
+			float size = pool.size[j] * (1.0f - pool.age[j] / pool.lifetime[j]);
+
+			if (fabsf(pool.positionX[j] - viewPosition.x) * 2.0f > viewSize.x + size || fabsf(pool.positionY[j] - viewPosition.y) * 2.0f > viewSize.y + size)
+				continue;
+
+			ParticleInstance& instance = instances[instanceCount++];
+			instance.position = glm::vec2(pool.positionX[j], pool.positionY[j]);
+			instance.uvOffset = pool.uvOffset[j];
+			instance.size = size;
+		}
+
+		batch.instanceCount = instanceCount - batch.firstInstance;
+	}
+
+	command->batchCount = (unsigned int)m_pools.size();
+	command->instanceCount = instanceCount;
+
+	std::chrono::duration<float, std::milli> recordTime = std::chrono::high_resolution_clock::now() - startTime;
+	m_stats.recordTime = recordTime.count();
+	m_stats.drawnCount = instanceCount;
+}
+
+void ParticleSystem::shiftOrigin(glm::vec2 worldDelta)
+{
+	for (size_t i = 0; i < m_pools.size(); i++)
+	{
+		ParticlePool& pool = m_pools[i];
+		float* positionX = pool.positionX.data();
+		float* positionY = pool.positionY.data();
+
+		for (size_t j = 0; j < pool.count; j++)
+		{
+			positionX[j] -= worldDelta.x;
+			positionY[j] -= worldDelta.y;
+		}
+	}
+
+	for (auto it = m_emitters.begin(); it != m_emitters.end(); it++)
+	{
+		it->second.position -= worldDelta;
+	}
+}
+
+size_t ParticleSystem::getParticleCount() const
+{
+	size_t particleCount = 0;
+	for (size_t i = 0; i < m_pools.size(); i++)
+	{
+		particleCount += m_pools[i].count;
+	}
+
+	return particleCount;
+}
+
+const ParticleStats& ParticleSystem::getLastFrameStats() const
+{
+	return m_stats;
+}
+
+void ParticleSystem::spawnBenchmark(glm::vec2 position)
+{
+	// Long lived, slowly drifting stone chips spread over a large area, so most of them are simulated but off screen
+	ParticleEmitter emitter;
+	emitter.texture = AssetManager::getInstance()->getTexture(ASSET_ID("blockSpritesheet"));
+	emitter.tileDimensions = glm::vec2(16);
+	emitter.uvOffset = glm::vec2(4, 1);
+	emitter.lifetimeMin = 20.0f;
+	emitter.lifetimeMax = 30.0f;
+	emitter.speedMin = 5.0f;
+	emitter.speedMax = 20.0f;
+	emitter.spread = glm::pi<float>();
+	emitter.sizeMin = 2.0f;
+	emitter.sizeMax = 4.0f;
+	emitter.spawnExtents = glm::vec2(4096.0f, 1024.0f);
+
+	burst(emitter, position, PARTICLE_BENCHMARK_COUNT);
+}
+
+void ParticleSystem::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice::getInstance()->setRenderPass(RENDER_PASS_PARTICLES);
+
+	if (type == COMMAND_DRAW)
+		executeDraw(*static_cast<const DrawCommand*>(data));
+}
+
+ParticleSystem::ParticlePool& ParticleSystem::getPool(const ParticleEmitter& emitter)
+{
+	glm::vec2 uvOffsetScaleFactor = emitter.texture.getUVOffsetScaleFactor(emitter.tileDimensions);
+
+	// There are only ever a handful of particle textures, so they're searched in order
+	for (size_t i = 0; i < m_pools.size(); i++)
+	{
+		if (m_pools[i].textureID == emitter.texture.id && m_pools[i].uvOffsetScaleFactor == uvOffsetScaleFactor)
+			return m_pools[i];
+	}
+
+	m_pools.push_back(ParticlePool());
+
+	ParticlePool& pool = m_pools.back();
+	pool.textureID = emitter.texture.id;
+	pool.uvOffsetScaleFactor = uvOffsetScaleFactor;
+	pool.count = 0;
+	resizePool(pool, PARTICLE_POOL_INITIAL_CAPACITY);
+
+	return pool;
+}
+
+void ParticleSystem::resizePool(ParticlePool& pool, size_t capacity)
+{
+	pool.positionX.resize(capacity);
+	pool.positionY.resize(capacity);
+	pool.velocityX.resize(capacity);
+	pool.velocityY.resize(capacity);
+	pool.gravity.resize(capacity);
+	pool.age.resize(capacity);
+	pool.lifetime.resize(capacity);
+	pool.size.resize(capacity);
+	pool.uvOffset.resize(capacity);
+}
+
+void ParticleSystem::spawn(ParticlePool& pool, const ParticleEmitter& emitter, glm::vec2 position, size_t count)
+{
+	// Pools double in size when they run out of room, up to their max capacity
+	size_t capacity = pool.positionX.size();
+	if (pool.count + count > capacity && capacity < PARTICLE_POOL_MAX_CAPACITY)
+		resizePool(pool, std::min(std::max(pool.count + count, capacity * 2), (size_t)PARTICLE_POOL_MAX_CAPACITY));
+
+	count = std::min(count, pool.positionX.size() - pool.count);
+
+	glm::vec2 uvOffset = emitter.texture.getUVOffset(emitter.uvOffset, emitter.tileDimensions);
+
+	for (size_t i = pool.count; i < pool.count + count; i++)
+	{
+		float angle = emitter.direction + random(-emitter.spread, emitter.spread);
+		float speed = random(emitter.speedMin, emitter.speedMax);
+
+		pool.positionX[i] = position.x + random(-emitter.spawnExtents.x, emitter.spawnExtents.x);
+		pool.positionY[i] = position.y + random(-emitter.spawnExtents.y, emitter.spawnExtents.y);
+		pool.velocityX[i] = cosf(angle) * speed;
+		pool.velocityY[i] = sinf(angle) * speed;
+		pool.gravity[i] = emitter.gravity;
+		pool.age[i] = 0.0f;
+		pool.lifetime[i] = random(emitter.lifetimeMin, emitter.lifetimeMax);
+		pool.size[i] = random(emitter.sizeMin, emitter.sizeMax);
+		pool.uvOffset[i] = uvOffset;
+	}
+
+	pool.count += count;
+}
+
+void ParticleSystem::integrate(ParticlePool& pool, float deltaTime)
+{
+	// Each array is only touched through its own pointer, with no branches, so the loop is vectorized
+	float* __restrict positionX = pool.positionX.data();
+	float* __restrict positionY = pool.positionY.data();
+	float* __restrict velocityX = pool.velocityX.data();
+	float* __restrict velocityY = pool.velocityY.data();
+	const float* __restrict gravity = pool.gravity.data();
+	float* __restrict age = pool.age.data();
+
+	int count = (int)pool.count;
+	for (int i = 0; i < count; i++)
+	{
+		velocityY[i] += gravity[i] * deltaTime;
+		positionX[i] += velocityX[i] * deltaTime;
+		positionY[i] += velocityY[i] * deltaTime;
+		age[i] += deltaTime;
+	}
+}
+
+void ParticleSystem::removeDead(ParticlePool& pool)
+{
+	// Dead particles are replaced by the last live particle, which is then checked in their place
+	size_t i = 0;
+	while (i < pool.count)
+	{
+		if (pool.age[i] < pool.lifetime[i])
+		{
+			i++;
+			continue;
+		}
+
+		size_t last = --pool.count;
+		pool.positionX[i] = pool.positionX[last];
+		pool.positionY[i] = pool.positionY[last];
+		pool.velocityX[i] = pool.velocityX[last];
+		pool.velocityY[i] = pool.velocityY[last];
+		pool.gravity[i] = pool.gravity[last];
+		pool.age[i] = pool.age[last];
+		pool.lifetime[i] = pool.lifetime[last];
+		pool.size[i] = pool.size[last];
+		pool.uvOffset[i] = pool.uvOffset[last];
+	}
+}
+
+float ParticleSystem::random(float min, float max)
+{
+	// Xorshift, since spawning a lot of particles at once would spend most of its time in rand()
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+
+	return min + (max - min) * ((m_randomState >> 8) / 16777216.0f);
+}
+
+void ParticleSystem::executeDraw(const DrawCommand& command)
+{
+	if (command.instanceCount == 0)
+	{
+		m_uploadBuffer->endFrame();
+		return;
+	}
+
+	const ParticleBatch* batches = reinterpret_cast<const ParticleBatch*>(&command + 1);
+	const ParticleInstance* instances = reinterpret_cast<const ParticleInstance*>(batches + command.batchCount);
+
+	if (command.instanceCount > m_instanceCapacity)
+		resizeInstanceBuffer(std::max((size_t)command.instanceCount, m_instanceCapacity * 2));
+
+	m_uploadBuffer->upload(m_instanceBuffer, 0, instances, sizeof(ParticleInstance) * command.instanceCount);
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->useProgram(command.shaderID);
+	device->uniform4f(5, 1.0f, 1.0f, 1.0f, 1.0f);
+	device->bindVertexArray(m_vao);
+
+	// One draw per texture
+	for (size_t i = 0; i < command.batchCount; i++)
+	{
+		const ParticleBatch& batch = batches[i];
+		if (batch.instanceCount == 0) continue;
+
+		device->bindTexture(batch.textureID);
+		device->uniform2f(6, batch.uvOffsetScaleFactor.x, batch.uvOffsetScaleFactor.y);
+		device->drawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, batch.instanceCount, batch.firstInstance);
+	}
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer->endFrame();
+}
+
+void ParticleSystem::resizeInstanceBuffer(size_t instanceCapacity)
+{
+	m_instanceCapacity = instanceCapacity;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(ParticleInstance) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+
+	// Position
+	device->enableVertexAttribArray(2);
+	device->vertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(ParticleInstance), 0);
+	device->vertexAttribDivisor(2, 1);
+
+	// Uv offset
+	device->enableVertexAttribArray(3);
+	device->vertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(ParticleInstance), sizeof(glm::vec2));
+	device->vertexAttribDivisor(3, 1);
+
+	// Size
+	device->enableVertexAttribArray(4);
+	device->vertexAttribPointer(4, 1, GL_FLOAT, false, sizeof(ParticleInstance), sizeof(glm::vec2) * 2);
+	device->vertexAttribDivisor(4, 1);
+
+	device->bindVertexArray(0);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Camera.h"
+#include "RenderQueue.h"
+#include "Components/Renderable.h"
+
+#define PARTICLE_POOL_INITIAL_CAPACITY 1024 // The number of particles each texture's pool can hold before it first grows
+#define PARTICLE_POOL_MAX_CAPACITY (2 * 1024 * 1024) // Particles spawned into a full pool past this are dropped
+#define PARTICLE_UPLOAD_RING_BUFFER_SIZE (32 * 1024 * 1024) // The size of the ring buffer particle instances are streamed through in bytes
+#define PARTICLE_BENCHMARK_COUNT 1000000 // The number of particles spawned by the particle benchmark
+
+// Describes the particles an emitter spawns. Each particle picks its lifetime, speed, direction and size at random
+// from the ranges, and is drawn with one tile of the texture.
+struct ParticleEmitter
+{
+	ParticleEmitter() : rate(0.0f), duration(0.0f), lifetimeMin(1.0f), lifetimeMax(1.0f), speedMin(0.0f), speedMax(0.0f),
+		direction(0.0f), spread(0.0f), sizeMin(1.0f), sizeMax(1.0f), gravity(0.0f) {}
+
+	Texture texture;
+	glm::vec2 tileDimensions;
+	glm::vec2 uvOffset; // The tile particles are drawn with
+
+	float rate; // Particles spawned per second
+	float duration; // How long the emitter spawns for in seconds, or negative to spawn until it's removed
+
+	float lifetimeMin, lifetimeMax; // In seconds
+	float speedMin, speedMax; // In pixels per second
+	float direction; // The angle particles are launched at in radians
+	float spread; // How far either side of the direction particles can be launched in radians
+	float sizeMin, sizeMax; // In pixels
+	float gravity; // Vertical acceleration in pixels per second squared
+	glm::vec2 spawnExtents; // Particles spawn anywhere within this far of the emitter's position
+};
+
+// A particle's per-instance data in the instance buffer
+struct ParticleInstance
+{
+	glm::vec2 position;
+	glm::vec2 uvOffset;
+	float size;
+};
+
+// Timings of the last update and render in milliseconds, for profiling
+struct ParticleStats
+{
+	ParticleStats() : particleCount(0), drawnCount(0), updateTime(0.0f), recordTime(0.0f) {}
+
+	size_t particleCount;
+	size_t drawnCount; // The particles that were on screen
+	float updateTime;
+	float recordTime;
+};
+
+class UploadRingBuffer;
+
+// Simulates and draws short-lived effects, like debris from broken blocks, dust and splashes.
+// Particles are kept in a pool per texture, with each property in its own array, so integrating them is a few
+// tight loops over floats the compiler can vectorize. Dead particles are swapped with the last live one, so the live
+// particles are always packed at the front of the arrays, and the arrays are kept between frames so spawning doesn't
+// allocate once they've grown. Each pool is drawn with one instanced call.
+class ParticleSystem : public RenderCommandHandler
+{
+public:
+	// The quad buffers are shared with the renderer system
+	ParticleSystem(unsigned int quadVertexBufferID, unsigned int quadIndexBufferID);
+	~ParticleSystem();
+
+	static ParticleSystem* getInstance();
+
+	// Returns the emitter's ID. The emitter is removed on its own once its duration is up.
+	size_t addEmitter(const ParticleEmitter& emitter, glm::vec2 position);
+	void moveEmitter(size_t emitterID, glm::vec2 position);
+	void removeEmitter(size_t emitterID);
+
+	// Spawns a number of particles at once, ignoring the emitter's rate and duration
+	void burst(const ParticleEmitter& emitter, glm::vec2 position, size_t count);
+
+	void update(float deltaTime);
+	void render(const Camera& camera);
+
+	void shiftOrigin(glm::vec2 worldDelta);
+
+	size_t getParticleCount() const;
+	const ParticleStats& getLastFrameStats() const;
+
+	// Fills the pools with PARTICLE_BENCHMARK_COUNT long lived particles around a position
+	void spawnBenchmark(glm::vec2 position);
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
+
+private:
+	enum CommandType
+	{
+		COMMAND_DRAW
+	};
+
+	// Every particle drawn with a texture, in structure of arrays form. Only the first count elements of each array are alive.
+	struct ParticlePool
+	{
+		unsigned int textureID;
+		glm::vec2 uvOffsetScaleFactor;
+		size_t count;
+
+		std::vector<float> positionX;
+		std::vector<float> positionY;
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> gravity;
+		std::vector<float> age;
+		std::vector<float> lifetime;
+		std::vector<float> size;
+		std::vector<glm::vec2> uvOffset;
+	};
+
+	struct ActiveEmitter
+	{
+		ParticleEmitter emitter;
+		glm::vec2 position;
+		float age;
+		float spawnDebt; // Fractions of a particle left over from previous frames
+	};
+
+	// A run of instances that share a texture
+	struct ParticleBatch
+	{
+		unsigned int textureID;
+		glm::vec2 uvOffsetScaleFactor;
+		unsigned int firstInstance;
+		unsigned int instanceCount;
+	};
+
+	// Followed by the batches, and then every batch's instances
+	struct DrawCommand
+	{
+		unsigned int shaderID;
+		unsigned int batchCount;
+		unsigned int instanceCount;
+	};
+
+	ParticlePool& getPool(const ParticleEmitter& emitter);
+	void resizePool(ParticlePool& pool, size_t capacity);
+	void spawn(ParticlePool& pool, const ParticleEmitter& emitter, glm::vec2 position, size_t count);
+
+	static void integrate(ParticlePool& pool, float deltaTime);
+	static void removeDead(ParticlePool& pool);
+
+	float random(float min, float max);
+
+	void executeDraw(const DrawCommand& command);
+	void resizeInstanceBuffer(size_t instanceCapacity);
+
+	static ParticleSystem* m_instance;
+
+	// Only used by the simulation
+	std::vector<ParticlePool> m_pools;
+	std::unordered_map<size_t, ActiveEmitter> m_emitters;
+	size_t m_nextEmitterID;
+	uint32_t m_randomState;
+	ParticleStats m_stats;
+	unsigned int m_shaderID; // 0 until the shader has loaded, and passed to the render thread with each draw
+
+	// Only used on the render thread once it has started
+	unsigned int m_vao;
+	unsigned int m_instanceBuffer;
+	size_t m_instanceCapacity;
+
+	UploadRingBuffer* m_uploadBuffer;
+};
@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "RenderQueue.h"
+
+#include "GraphicsDevice.h"
+
+#include <GLFW/glfw3.h>
+
+RenderQueue* RenderQueue::m_instance = nullptr;
+
+void RenderCommandList::clear()
+{
+	m_commands.clear();
+	m_data.clear();
+}
+
+void* RenderCommandList::record(RenderCommandHandler* handler, unsigned int type, size_t dataSize)
+{
+	RenderCommand command;
+	command.handler = handler;
+	command.type = type;
+	command.dataOffset = (m_data.size() + RENDER_COMMAND_DATA_ALIGNMENT - 1) & ~(size_t)(RENDER_COMMAND_DATA_ALIGNMENT - 1);
+	command.dataSize = dataSize;
+
+	m_commands.push_back(command);
+	m_data.resize(command.dataOffset + dataSize);
+
+	return m_data.data() + command.dataOffset;
+}
+
+void RenderCommandList::execute() const
+{
+	for (size_t i = 0; i < m_commands.size(); i++)
+	{
+		const RenderCommand& command = m_commands[i];
+		command.handler->executeRenderCommand(command.type, m_data.data() + command.dataOffset, command.dataSize);
+	}
+}
+
+RenderQueue::RenderQueue()
+	: m_window(nullptr), m_recordingIndex(0), m_pendingIndex(-1), m_isRendering(false), m_shouldStop(false), m_presentedFrameCount(0)
+{
+	if (!m_instance)
+		m_instance = this;
+}
+
+RenderQueue::~RenderQueue()
+{
+	stop();
+
+	if (m_instance == this)
+		m_instance = nullptr;
+}
+
+RenderQueue* RenderQueue::getInstance()
+{
+	return m_instance;
+}
+
+void RenderQueue::start(GLFWwindow* window)
+{
+	if (m_thread.joinable()) return;
+
+	m_window = window;
+	m_shouldStop = false;
+
+	// The GL context can only be current on one thread at a time, so it's handed over to the render thread
+	glfwMakeContextCurrent(nullptr);
+	m_thread = std::thread(&RenderQueue::renderLoop, this);
+}
+
+void RenderQueue::stop()
+{
+	if (!m_thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shouldStop = true;
+	}
+	m_cv.notify_all();
+
+	m_thread.join();
+
+	// Take the GL context back, so GL resources can be cleaned up on this thread
+	glfwMakeContextCurrent(m_window);
+}
+
+void* RenderQueue::record(RenderCommandHandler* handler, unsigned int type, size_t dataSize)
+{
+	return m_commandLists[m_recordingIndex].record(handler, type, dataSize);
+}
+
+void RenderQueue::submitFrame()
+{
+	// Without a render thread, such as when running headless, the frame is executed straight away
+	if (!m_thread.joinable())
+	{
+		m_commandLists[m_recordingIndex].execute();
+		GraphicsDevice::getInstance()->endFrame();
+		m_commandLists[m_recordingIndex].clear();
+		m_presentedFrameCount++;
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// The other list is only free once the render thread has finished with it
+	m_cv.wait(lock, [this]() { return (!m_isRendering && m_pendingIndex == -1) || m_shouldStop; });
+
+	m_pendingIndex = m_recordingIndex;
+	m_recordingIndex = 1 - m_recordingIndex;
+	m_commandLists[m_recordingIndex].clear();
+
+	lock.unlock();
+	m_cv.notify_all();
+}
+
+size_t RenderQueue::getPresentedFrameCount() const
+{
+	return m_presentedFrameCount;
+}
+
+void RenderQueue::renderLoop()
+{
+	glfwMakeContextCurrent(m_window);
+
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this]() { return m_pendingIndex != -1 || m_shouldStop; });
+
+		// Any frame that was already submitted is still presented before stopping
+		if (m_pendingIndex == -1) break;
+
+		int renderingIndex = m_pendingIndex;
+		m_pendingIndex = -1;
+		m_isRendering = true;
+		lock.unlock();
+
+		m_commandLists[renderingIndex].execute();
+		GraphicsDevice::getInstance()->endFrame();
+		glfwSwapBuffers(m_window);
+		m_presentedFrameCount++;
+
+		lock.lock();
+		m_isRendering = false;
+		lock.unlock();
+		m_cv.notify_all();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
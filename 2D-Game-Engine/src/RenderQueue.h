@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define RENDER_COMMAND_DATA_ALIGNMENT 16 // The alignment of each command's data, so it can be read in place as any struct
+
+struct GLFWwindow;
+
+// Anything that records render commands executes them on the render thread through this
+class RenderCommandHandler
+{
+public:
+	virtual ~RenderCommandHandler() {}
+
+	virtual void executeRenderCommand(unsigned int type, const void* data, size_t size) = 0;
+};
+
+struct RenderCommand
+{
+	RenderCommandHandler* handler;
+	unsigned int type; // What the command is, which is up to the handler
+	size_t dataOffset;
+	size_t dataSize;
+};
+
+// One frame of recorded render commands, with each command's data packed into a single byte buffer.
+// Both are kept between frames, so recording doesn't allocate once they've grown to fit a frame.
+class RenderCommandList
+{
+public:
+	void clear();
+
+	// Adds a command and returns its data to be filled in. The data is only valid until the next command is recorded.
+	void* record(RenderCommandHandler* handler, unsigned int type, size_t dataSize);
+
+	template<typename T>
+	T* record(RenderCommandHandler* handler, unsigned int type, size_t extraDataSize = 0)
+	{
+		return static_cast<T*>(record(handler, type, sizeof(T) + extraDataSize));
+	}
+
+	void execute() const;
+
+private:
+	std::vector<RenderCommand> m_commands;
+	std::vector<unsigned char> m_data;
+};
+
+// The simulation records a frame's render commands while the render thread, which owns the GL context, executes
+// and presents the previous frame. Anything created before the render thread starts is created on the calling thread.
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	static RenderQueue* getInstance();
+
+	void start(GLFWwindow* window);
+	void stop();
+
+	// Records into the frame being built by the simulation
+	void* record(RenderCommandHandler* handler, unsigned int type, size_t dataSize);
+
+	template<typename T>
+	T* record(RenderCommandHandler* handler, unsigned int type, size_t extraDataSize = 0)
+	{
+		return m_commandLists[m_recordingIndex].record<T>(handler, type, extraDataSize);
+	}
+
+	// Hands the recorded frame to the render thread. Waits for the render thread to finish the frame before it,
+	// so there's never more than one frame waiting to be rendered. If the render thread was never started, the frame is executed here.
+	void submitFrame();
+
+	size_t getPresentedFrameCount() const;
+
+private:
+	void renderLoop();
+
+	static RenderQueue* m_instance;
+
+	GLFWwindow* m_window;
+
+	RenderCommandList m_commandLists[2];
+	int m_recordingIndex; // The list the simulation is recording into
+	int m_pendingIndex; // The list waiting for the render thread, or -1 if there isn't one
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_isRendering;
+	bool m_shouldStop;
+
+	std::atomic<size_t> m_presentedFrameCount;
+};
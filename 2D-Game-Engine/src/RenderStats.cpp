@@ -0,0 +1,185 @@
+#include "stdafx.h"
+#include "RenderStats.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static const char* passNames[RENDER_PASS_COUNT] = { "frame", "terrain", "sprites", "particles", "debugPhysics", "text" };
+
+static const char* counterNames[RENDER_COUNTER_COUNT] =
+{
+	"drawCalls", "draws", "instances", "triangles", "programBinds", "textureBinds", "stateChanges", "uniformBytes", "uploadBytes", "copyBytes"
+};
+
+RenderCounters& RenderCounters::operator+=(const RenderCounters& other)
+{
+	for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+	{
+		values[i] += other.values[i];
+	}
+
+	return *this;
+}
+
+RenderStats::RenderStats()
+	: m_nextFrame(0), m_frameCount(0)
+{
+}
+
+const char* RenderStats::getPassName(RenderPass pass)
+{
+	return pass < RENDER_PASS_COUNT ? passNames[pass] : "total";
+}
+
+const char* RenderStats::getCounterName(RenderCounter counter)
+{
+	return counterNames[counter];
+}
+
+void RenderStats::addFrame(const RenderCounters (&passCounters)[RENDER_PASS_COUNT])
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (int i = 0; i < RENDER_PASS_COUNT; i++)
+	{
+		m_history[m_nextFrame][i] = passCounters[i];
+	}
+
+	m_nextFrame = (m_nextFrame + 1) % RENDER_STATS_HISTORY_LENGTH;
+	m_frameCount = std::min(m_frameCount + 1, (size_t)RENDER_STATS_HISTORY_LENGTH);
+}
+
+size_t RenderStats::getFrameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_frameCount;
+}
+
+RenderCounters RenderStats::getLastFrame(RenderPass pass) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_frameCount == 0) return RenderCounters();
+
+	return getFrame(m_frameCount - 1, pass);
+}
+
+RollingRenderCounters RenderStats::getRolling(RenderPass pass) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	RollingRenderCounters rolling;
+	if (m_frameCount == 0) return rolling;
+
+	for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+	{
+		rolling.min[i] = SIZE_MAX;
+	}
+
+	for (size_t frame = 0; frame < m_frameCount; frame++)
+	{
+		RenderCounters counters = getFrame(frame, pass);
+		for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+		{
+			rolling.min[i] = std::min(rolling.min[i], counters.values[i]);
+			rolling.max[i] = std::max(rolling.max[i], counters.values[i]);
+			rolling.average[i] += counters.values[i];
+		}
+	}
+
+	for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+	{
+		rolling.average[i] /= m_frameCount;
+	}
+
+	return rolling;
+}
+
+std::string RenderStats::getSummary() const
+{
+	// Each row is a counter, with the min/avg/max of every pass and the totals in the columns
+	std::ostringstream summary;
+	summary << std::fixed << std::setprecision(1);
+	summary << "Render stats over the last " << getFrameCount() << " frames (min/avg/max)\n";
+
+	summary << std::setw(14) << "";
+	for (int pass = 0; pass <= RENDER_PASS_COUNT; pass++)
+	{
+		summary << std::setw(28) << getPassName((RenderPass)pass);
+	}
+	summary << "\n";
+
+	RollingRenderCounters rolling[RENDER_PASS_COUNT + 1];
+	for (int pass = 0; pass <= RENDER_PASS_COUNT; pass++)
+	{
+		rolling[pass] = getRolling((RenderPass)pass);
+	}
+
+	for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+	{
+		summary << std::setw(14) << counterNames[i];
+		for (int pass = 0; pass <= RENDER_PASS_COUNT; pass++)
+		{
+			std::ostringstream cell;
+			cell << std::fixed << std::setprecision(1) << rolling[pass].min[i] << "/" << rolling[pass].average[i] << "/" << rolling[pass].max[i];
+			summary << std::setw(28) << cell.str();
+		}
+		summary << "\n";
+	}
+
+	return summary.str();
+}
+
+bool RenderStats::writeHistory(const char* filepath) const
+{
+	std::ofstream ofs(filepath);
+	if (!ofs.is_open())
+	{
+		Output::error("ERROR: Failed to open " + std::string(filepath) + " to write the render stats");
+		return false;
+	}
+
+	ofs << "frame";
+	for (int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+	{
+		for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+		{
+			ofs << "," << passNames[pass] << "." << counterNames[i];
+		}
+	}
+	ofs << "\n";
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t frame = 0; frame < m_frameCount; frame++)
+	{
+		ofs << frame;
+		for (int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+		{
+			RenderCounters counters = getFrame(frame, (RenderPass)pass);
+			for (int i = 0; i < RENDER_COUNTER_COUNT; i++)
+			{
+				ofs << "," << counters.values[i];
+			}
+		}
+		ofs << "\n";
+	}
+
+	return true;
+}
+
+RenderCounters RenderStats::getFrame(size_t frame, RenderPass pass) const
+{
+	// Frames are counted from the oldest one in the history
+	size_t index = (m_nextFrame + RENDER_STATS_HISTORY_LENGTH - m_frameCount + frame) % RENDER_STATS_HISTORY_LENGTH;
+	if (pass < RENDER_PASS_COUNT)
+		return m_history[index][pass];
+
+	RenderCounters total;
+	for (int i = 0; i < RENDER_PASS_COUNT; i++)
+	{
+		total += m_history[index][i];
+	}
+
+	return total;
+}
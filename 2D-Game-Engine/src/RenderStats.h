@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#define RENDER_STATS_HISTORY_LENGTH 120 // Number of frames the rolling min, average and max are taken over
+#define RENDER_STATS_DUMP_FILEPATH "render_stats.csv" // Where the history is written when the render stats are dumped
+
+// The parts of a frame that are counted separately
+enum RenderPass
+{
+	RENDER_PASS_FRAME, // Clearing, the viewport and the camera
+	RENDER_PASS_TERRAIN,
+	RENDER_PASS_SPRITES,
+	RENDER_PASS_PARTICLES,
+	RENDER_PASS_DEBUG_PHYSICS,
+	RENDER_PASS_TEXT, // Text and the HUD drawn over the screen
+	RENDER_PASS_COUNT
+};
+
+enum RenderCounter
+{
+	RENDER_COUNTER_DRAW_CALLS, // Calls to a draw function
+	RENDER_COUNTER_DRAWS, // Draws made by those calls, which is more than the calls when a multi-draw is used
+	RENDER_COUNTER_INSTANCES,
+	RENDER_COUNTER_TRIANGLES,
+	RENDER_COUNTER_PROGRAM_BINDS,
+	RENDER_COUNTER_TEXTURE_BINDS,
+	RENDER_COUNTER_STATE_CHANGES, // Vertex array and buffer base binds, and fixed function state changes
+	RENDER_COUNTER_UNIFORM_BYTES,
+	RENDER_COUNTER_UPLOAD_BYTES, // Bytes uploaded from the CPU into buffers, including writes to persistently mapped buffers
+	RENDER_COUNTER_COPY_BYTES, // Bytes copied between buffers on the GPU
+	RENDER_COUNTER_COUNT
+};
+
+// Every counter for one pass of one frame
+struct RenderCounters
+{
+	RenderCounters() : values() {}
+
+	RenderCounters& operator+=(const RenderCounters& other);
+
+	size_t values[RENDER_COUNTER_COUNT];
+};
+
+// Every counter's min, average and max over the last RENDER_STATS_HISTORY_LENGTH frames
+struct RollingRenderCounters
+{
+	RollingRenderCounters() : min(), max(), average() {}
+
+	size_t min[RENDER_COUNTER_COUNT];
+	size_t max[RENDER_COUNTER_COUNT];
+	double average[RENDER_COUNTER_COUNT];
+};
+
+// Keeps the counters of the last RENDER_STATS_HISTORY_LENGTH frames. Frames are added on the render thread,
+// while the stats can be queried from anywhere.
+class RenderStats
+{
+public:
+	RenderStats();
+
+	static const char* getPassName(RenderPass pass);
+	static const char* getCounterName(RenderCounter counter);
+
+	void addFrame(const RenderCounters (&passCounters)[RENDER_PASS_COUNT]);
+
+	size_t getFrameCount() const; // The number of frames in the history
+
+	// Passing RENDER_PASS_COUNT gives the totals for every pass
+	RenderCounters getLastFrame(RenderPass pass = RENDER_PASS_COUNT) const;
+	RollingRenderCounters getRolling(RenderPass pass = RENDER_PASS_COUNT) const;
+
+	// A table of every pass's rolling counters
+	std::string getSummary() const;
+
+	// Writes every frame in the history as CSV, with a column for each pass's counters
+	bool writeHistory(const char* filepath) const;
+
+private:
+	RenderCounters getFrame(size_t frame, RenderPass pass) const;
+
+	RenderCounters m_history[RENDER_STATS_HISTORY_LENGTH][RENDER_PASS_COUNT];
+	size_t m_nextFrame; // The history slot the next frame is written to
+	size_t m_frameCount;
+
+	mutable std::mutex m_mutex;
+};
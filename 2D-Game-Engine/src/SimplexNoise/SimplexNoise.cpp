@@ -185,15 +185,46 @@ void SimplexNoise::init(unsigned int seed)
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
 float SimplexNoise::noise(float x) {
-    float n0, n1;   // Noise contributions from the two "corners"
-
     // No need to skew the input space in 1D
 
     // Corners coordinates (nearest integer values):
     int32_t i0 = fastfloor(x);
-    int32_t i1 = i0 + 1;
     // Distances to corners (between 0 and 1):
     float x0 = x - i0;
+
+    return noiseCorners(i0, x0);
+}
+
+/**
+ * 1D Perlin simplex noise, with the input split into cell and offset in double precision
+ *
+ * The permutation table repeats every 256 cells, so the cell can be wrapped before it's
+ * hashed, which keeps the result exact however far the coordinate is from the origin.
+ *
+ * @param[in] x double coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::noise(double x) {
+    const double cell = floor(x);
+    const int32_t i0 = static_cast<int32_t>(static_cast<int64_t>(cell) & 0xFF);
+    const float x0 = static_cast<float>(x - cell);
+
+    return noiseCorners(i0, x0);
+}
+
+/**
+ * Sums the contributions of the two corners of a 1D simplex cell
+ *
+ * @param[in] i0 the cell's first corner
+ * @param[in] x0 the distance to the first corner (between 0 and 1)
+ *
+ * @return Noise value in the range[-1; 1]
+ */
+float SimplexNoise::noiseCorners(int32_t i0, float x0) {
+    float n0, n1;   // Noise contributions from the two "corners"
+
+    int32_t i1 = i0 + 1;
     float x1 = x0 - 1.0f;
 
     // Calculate the contribution from the first corner
@@ -213,6 +244,10 @@ float SimplexNoise::noise(float x) {
     return 0.395f * (n0 + n1);
 }
 
+// Skewing/Unskewing factors for 2D
+static const float F2 = 0.366025403f;  // F2 = (sqrt(3) - 1) / 2
+static const float G2 = 0.211324865f;  // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
+
 /**
  * 2D Perlin simplex noise
  *
@@ -224,12 +259,6 @@ float SimplexNoise::noise(float x) {
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
 float SimplexNoise::noise(float x, float y) {
-    float n0, n1, n2;   // Noise contributions from the three corners
-
-    // Skewing/Unskewing factors for 2D
-    static const float F2 = 0.366025403f;  // F2 = (sqrt(3) - 1) / 2
-    static const float G2 = 0.211324865f;  // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
-
     // Skew the input space to determine which simplex cell we're in
     const float s = (x + y) * F2;  // Hairy factor for 2D
     const float xs = x + s;
@@ -244,6 +273,45 @@ float SimplexNoise::noise(float x, float y) {
     const float x0 = x - X0;  // The x,y distances from the cell origin
     const float y0 = y - Y0;
 
+    return noiseCorners(i, j, x0, y0);
+}
+
+/**
+ * 2D Perlin simplex noise, with the skewing done in double precision
+ *
+ * @param[in] x double coordinate
+ * @param[in] y double coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::noise(double x, double y) {
+    // Skew the input space to determine which simplex cell we're in
+    const double s = (x + y) * static_cast<double>(F2);
+    const double i = floor(x + s);
+    const double j = floor(y + s);
+
+    // Unskew the cell origin back to (x,y) space and get the distances from it
+    const double t = (i + j) * static_cast<double>(G2);
+    const float x0 = static_cast<float>(x - (i - t));
+    const float y0 = static_cast<float>(y - (j - t));
+
+    // The permutation table repeats every 256 cells, so the cell can be wrapped before it's hashed
+    return noiseCorners(static_cast<int32_t>(static_cast<int64_t>(i) & 0xFF), static_cast<int32_t>(static_cast<int64_t>(j) & 0xFF), x0, y0);
+}
+
+/**
+ * Sums the contributions of the three corners of a 2D simplex cell
+ *
+ * @param[in] i  the cell's x coordinate in skewed space
+ * @param[in] j  the cell's y coordinate in skewed space
+ * @param[in] x0 the x distance from the cell origin
+ * @param[in] y0 the y distance from the cell origin
+ *
+ * @return Noise value in the range[-1; 1]
+ */
+float SimplexNoise::noiseCorners(int32_t i, int32_t j, float x0, float y0) {
+    float n0, n1, n2;   // Noise contributions from the three corners
+
     // For the 2D case, the simplex shape is an equilateral triangle.
     // Determine which simplex we are in.
     int32_t i1, j1;  // Offsets for second (middle) corner of simplex in (i,j) coords
@@ -302,6 +370,10 @@ float SimplexNoise::noise(float x, float y) {
 }
 
 
+// Skewing/Unskewing factors for 3D
+static const float F3 = 1.0f / 3.0f;
+static const float G3 = 1.0f / 6.0f;
+
 /**
  * 3D Perlin simplex noise
  *
@@ -312,12 +384,6 @@ float SimplexNoise::noise(float x, float y) {
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
 float SimplexNoise::noise(float x, float y, float z) {
-    float n0, n1, n2, n3; // Noise contributions from the four corners
-
-    // Skewing/Unskewing factors for 3D
-    static const float F3 = 1.0f / 3.0f;
-    static const float G3 = 1.0f / 6.0f;
-
     // Skew the input space to determine which simplex cell we're in
     float s = (x + y + z) * F3; // Very nice and simple skew factor for 3D
     int i = fastfloor(x + s);
@@ -331,6 +397,51 @@ float SimplexNoise::noise(float x, float y, float z) {
     float y0 = y - Y0;
     float z0 = z - Z0;
 
+    return noiseCorners(i, j, k, x0, y0, z0);
+}
+
+/**
+ * 3D Perlin simplex noise, with the skewing done in double precision
+ *
+ * @param[in] x double coordinate
+ * @param[in] y double coordinate
+ * @param[in] z double coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::noise(double x, double y, double z) {
+    // Skew the input space to determine which simplex cell we're in
+    const double s = (x + y + z) * static_cast<double>(F3);
+    const double i = floor(x + s);
+    const double j = floor(y + s);
+    const double k = floor(z + s);
+
+    // Unskew the cell origin back to (x,y,z) space and get the distances from it
+    const double t = (i + j + k) * static_cast<double>(G3);
+    const float x0 = static_cast<float>(x - (i - t));
+    const float y0 = static_cast<float>(y - (j - t));
+    const float z0 = static_cast<float>(z - (k - t));
+
+    // The permutation table repeats every 256 cells, so the cell can be wrapped before it's hashed
+    return noiseCorners(static_cast<int32_t>(static_cast<int64_t>(i) & 0xFF), static_cast<int32_t>(static_cast<int64_t>(j) & 0xFF),
+        static_cast<int32_t>(static_cast<int64_t>(k) & 0xFF), x0, y0, z0);
+}
+
+/**
+ * Sums the contributions of the four corners of a 3D simplex cell
+ *
+ * @param[in] i  the cell's x coordinate in skewed space
+ * @param[in] j  the cell's y coordinate in skewed space
+ * @param[in] k  the cell's z coordinate in skewed space
+ * @param[in] x0 the x distance from the cell origin
+ * @param[in] y0 the y distance from the cell origin
+ * @param[in] z0 the z distance from the cell origin
+ *
+ * @return Noise value in the range[-1; 1]
+ */
+float SimplexNoise::noiseCorners(int32_t i, int32_t j, int32_t k, float x0, float y0, float z0) {
+    float n0, n1, n2, n3; // Noise contributions from the four corners
+
     // For the 3D case, the simplex shape is a slightly irregular tetrahedron.
     // Determine which simplex we are in.
     int i1, j1, k1; // Offsets for second corner of simplex in (i,j,k) coords
@@ -485,3 +596,54 @@ float SimplexNoise::fractal(size_t octaves, float x, float y, float z) const {
 
     return (output / denom);
 }
+
+/**
+ * Fractal/Fractional Brownian Motion (fBm) summation of 1D Perlin Simplex noise in double precision
+ *
+ * @param[in] octaves   number of fraction of noise to sum
+ * @param[in] x         double coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, double x) const {
+    float output    = 0.f;
+    float denom     = 0.f;
+    double frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        output += (amplitude * noise(x * frequency));
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
+
+/**
+ * Fractal/Fractional Brownian Motion (fBm) summation of 2D Perlin Simplex noise in double precision
+ *
+ * @param[in] octaves   number of fraction of noise to sum
+ * @param[in] x         x double coordinate
+ * @param[in] y         y double coordinate
+ *
+ * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
+ */
+float SimplexNoise::fractal(size_t octaves, double x, double y) const {
+    float output = 0.f;
+    float denom  = 0.f;
+    double frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        output += (amplitude * noise(x * frequency, y * frequency));
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    return (output / denom);
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <cstdint>  // int32_t
 #include <algorithm> // std::sort
 
 /**
@@ -28,11 +29,20 @@ public:
     // 3D Perlin simplex noise
     static float noise(float x, float y, float z);
 
+    // Perlin simplex noise with double precision input, for coordinates far from the origin
+    static float noise(double x);
+    static float noise(double x, double y);
+    static float noise(double x, double y, double z);
+
     // Fractal/Fractional Brownian Motion (fBm) noise summation
     float fractal(size_t octaves, float x) const;
     float fractal(size_t octaves, float x, float y) const;
     float fractal(size_t octaves, float x, float y, float z) const;
 
+    // Fractal/Fractional Brownian Motion (fBm) noise summation with double precision input
+    float fractal(size_t octaves, double x) const;
+    float fractal(size_t octaves, double x, double y) const;
+
     /**
      * Constructor of to initialize a fractal noise summation
      *
@@ -48,6 +58,11 @@ public:
 		float persistence = 0.5f) : mFrequency(frequency), mAmplitude(amplitude), mLacunarity(lacunarity), mPersistence(persistence) {}
 
 private:
+	// Sum the contributions of a simplex cell's corners, given the cell and the distance from its origin
+	static float noiseCorners(int32_t i0, float x0);
+	static float noiseCorners(int32_t i, int32_t j, float x0, float y0);
+	static float noiseCorners(int32_t i, int32_t j, int32_t k, float x0, float y0, float z0);
+
 	static unsigned int sSeed;
 
     // Parameters of Fractional Brownian Motion (fBm) : sum of N "octaves" of noise
@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "SpatialGrid.h"
+
+void SpatialGrid::update(size_t entityID, glm::vec2 position, glm::vec2 size)
+{
+	// Positions are the center of the entity
+	CellRange cellRange = getCellRange(position - size * 0.5f, position + size * 0.5f);
+
+	// Most moves stay within the same cells, so there's nothing to do
+	auto it = m_entityCells.find(entityID);
+	if (it != m_entityCells.end())
+	{
+		if (it->second == cellRange) return;
+		remove(entityID);
+	}
+
+	for (int y = cellRange.minY; y <= cellRange.maxY; y++)
+	{
+		for (int x = cellRange.minX; x <= cellRange.maxX; x++)
+		{
+			m_cells[getCellKey(x, y)].push_back(entityID);
+		}
+	}
+
+	m_entityCells[entityID] = cellRange;
+}
+
+void SpatialGrid::remove(size_t entityID)
+{
+	auto it = m_entityCells.find(entityID);
+	if (it == m_entityCells.end()) return;
+
+	const CellRange& cellRange = it->second;
+	for (int y = cellRange.minY; y <= cellRange.maxY; y++)
+	{
+		for (int x = cellRange.minX; x <= cellRange.maxX; x++)
+		{
+			auto cellIt = m_cells.find(getCellKey(x, y));
+			if (cellIt == m_cells.end()) continue;
+
+			// The order of entities in a cell doesn't matter, so swap and pop
+			std::vector<size_t>& cell = cellIt->second;
+			auto entityIt = std::find(cell.begin(), cell.end(), entityID);
+			if (entityIt != cell.end())
+			{
+				*entityIt = cell.back();
+				cell.pop_back();
+			}
+
+			if (cell.empty())
+				m_cells.erase(cellIt);
+		}
+	}
+
+	m_entityCells.erase(it);
+}
+
+void SpatialGrid::clear()
+{
+	m_cells.clear();
+	m_entityCells.clear();
+}
+
+void SpatialGrid::query(glm::vec2 min, glm::vec2 max, std::vector<size_t>& entityIDs) const
+{
+	entityIDs.clear();
+
+	CellRange cellRange = getCellRange(min, max);
+	for (int y = cellRange.minY; y <= cellRange.maxY; y++)
+	{
+		for (int x = cellRange.minX; x <= cellRange.maxX; x++)
+		{
+			auto cellIt = m_cells.find(getCellKey(x, y));
+			if (cellIt != m_cells.end())
+				entityIDs.insert(entityIDs.end(), cellIt->second.begin(), cellIt->second.end());
+		}
+	}
+
+	// Entities that span several cells are found once for each
+	std::sort(entityIDs.begin(), entityIDs.end());
+	entityIDs.erase(std::unique(entityIDs.begin(), entityIDs.end()), entityIDs.end());
+}
+
+SpatialGrid::CellRange SpatialGrid::getCellRange(glm::vec2 min, glm::vec2 max) const
+{
+	CellRange cellRange;
+	cellRange.minX = (int)floorf(min.x / SPATIAL_GRID_CELL_SIZE);
+	cellRange.minY = (int)floorf(min.y / SPATIAL_GRID_CELL_SIZE);
+	cellRange.maxX = (int)floorf(max.x / SPATIAL_GRID_CELL_SIZE);
+	cellRange.maxY = (int)floorf(max.y / SPATIAL_GRID_CELL_SIZE);
+
+	return cellRange;
+}
+
+uint64_t SpatialGrid::getCellKey(int x, int y)
+{
+	return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
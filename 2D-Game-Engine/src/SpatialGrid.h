@@ -0,0 +1,34 @@
+#pragma once
+
+#define SPATIAL_GRID_CELL_SIZE 512.0f // The width (and height) of a spatial grid cell in pixels
+
+// A uniform grid that finds the entities overlapping a rectangle without testing every entity. Each entity is kept in
+// every cell its rectangle overlaps, and only moves between cells when it crosses a cell boundary.
+class SpatialGrid
+{
+public:
+	void update(size_t entityID, glm::vec2 position, glm::vec2 size);
+	void remove(size_t entityID);
+	void clear();
+
+	// Finds the entities in the cells a rectangle overlaps. The IDs are sorted and unique, but may include entities
+	// that are near the rectangle without overlapping it.
+	void query(glm::vec2 min, glm::vec2 max, std::vector<size_t>& entityIDs) const;
+
+private:
+	struct CellRange
+	{
+		bool operator==(const CellRange& other) const { return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY; }
+
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+	};
+
+	CellRange getCellRange(glm::vec2 min, glm::vec2 max) const;
+	static uint64_t getCellKey(int x, int y);
+
+	std::unordered_map<uint64_t, std::vector<size_t>> m_cells;
+	std::unordered_map<size_t, CellRange> m_entityCells;
+};
@@ -191,6 +191,24 @@ void PhysicsSystem::applyImpulse(size_t entityID, glm::vec2 force, size_t compon
 	}
 }
 
+glm::vec2 PhysicsSystem::getVelocity(size_t entityID, size_t componentIndex)
+{
+	const PhysicsObject* physicsObject = getComponent(entityID, componentIndex);
+	if (physicsObject)
+	{
+		b2Vec2 velocity = physicsObject->body->GetLinearVelocity();
+		return glm::vec2(velocity.x * PHYSICS_PIXELS_PER_METER, velocity.y * PHYSICS_PIXELS_PER_METER);
+	}
+
+	return glm::vec2();
+}
+
+void PhysicsSystem::shiftOrigin(glm::vec2 worldDelta)
+{
+	// Moves every body (including the terrain's chunk bodies) so that worldDelta becomes the new origin
+	m_physicsWorld->ShiftOrigin(b2Vec2(worldDelta.x / PHYSICS_PIXELS_PER_METER, worldDelta.y / PHYSICS_PIXELS_PER_METER));
+}
+
 void PhysicsSystem::update()
 {
 	m_physicsWorld->Step(PHYSICS_TIMESTEP, 8, 3);
@@ -50,6 +50,10 @@ public:
 
 	void applyImpulse(size_t entityID, glm::vec2 force, size_t componentIndex = 0);
 
+	glm::vec2 getVelocity(size_t entityID, size_t componentIndex = 0);
+
+	void shiftOrigin(glm::vec2 worldDelta);
+
 	void update();
 
 #ifdef _DEBUG
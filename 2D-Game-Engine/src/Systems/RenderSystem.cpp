@@ -3,9 +3,9 @@
 
 #include "TransformSystem.h"
 
+#include "../GraphicsDevice.h"
 #include "../Terrain.h"
-
-#include <GL/glew.h>
+#include "../UploadRingBuffer.h"
 
 static const Vertex quadVertices[4] =
 {
@@ -22,57 +22,85 @@ static const unsigned char quadIndices[6] =
 };
 
 RendererSystem::RendererSystem()
+	: m_cameraBuffer(0), m_instanceBuffer(0), m_instanceCapacity(0)
 {
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
 	// Create the VAO to use for most sprites
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
+	m_vao = device->createVertexArray();
+	device->bindVertexArray(m_vao);
 
 	// Vertex buffer
-	glGenBuffers(1, &m_vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	m_vertexBuffer = device->createBuffer();
+	device->bindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
 	// Index buffer
-	glGenBuffers(1, &m_indexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	m_indexBuffer = device->createBuffer();
+	device->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 
 	// Populate the vertex and index buffers. These are static, since all quads are the same.
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * 4, quadVertices, GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned char) * 6, quadIndices, GL_STATIC_DRAW);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * 4, quadVertices, GL_STATIC_DRAW);
+	device->bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned char) * 6, quadIndices, GL_STATIC_DRAW);
 
 	// Setup vertex attribute pointers
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	device->enableVertexAttribArray(0);
+	device->vertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex), 0);
+
+	device->enableVertexAttribArray(1);
+	device->vertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(Vertex), sizeof(float) * 2);
+
+	// Sprite instances are streamed into the instance buffer each frame, which grows as more sprites are drawn
+	m_instanceBuffer = device->createBuffer();
+	resizeInstanceBuffer(1024);
+
+	m_uploadBuffer = new UploadRingBuffer(SPRITE_UPLOAD_RING_BUFFER_SIZE);
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(float) * 2));
+	device->bindVertexArray(0);
+
+	// The camera is uploaded once per frame and stays bound for every shader to read
+	m_cameraBuffer = device->createBuffer();
+	device->bindBuffer(GL_UNIFORM_BUFFER, m_cameraBuffer);
+	device->bufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), nullptr, GL_DYNAMIC_DRAW);
+	device->bindBuffer(GL_UNIFORM_BUFFER, 0);
+	device->bindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BUFFER_BINDING, m_cameraBuffer);
 
 	// We don't need these since we're only working with 2D
-	glDisable(GL_CULL_FACE);
-	glDisable(GL_DEPTH_TEST);
+	device->disable(GL_CULL_FACE);
+	device->disable(GL_DEPTH_TEST);
 
 	// Enable blending for transparent sprites
-	/*glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);*/
+	/*device->enable(GL_BLEND);
+	device->blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);*/
 
 	// Cornflower blue
-	glClearColor(0.392157f, 0.584314f, 0.929412f, 1);
+	device->clearColor(0.392157f, 0.584314f, 0.929412f, 1);
 
 	AssetManager::getInstance()->loadShader("defaultShader", "shaders/vertexShader.glsl", "shaders/fragmentShader.glsl");
 }
 
 RendererSystem::~RendererSystem()
 {
-	glDeleteBuffers(1, &m_vertexBuffer);
-	glDeleteBuffers(1, &m_indexBuffer);
-	glDeleteVertexArrays(1, &m_vao);
+	delete m_uploadBuffer;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->deleteBuffer(m_cameraBuffer);
+	device->deleteBuffer(m_instanceBuffer);
+	device->deleteBuffer(m_vertexBuffer);
+	device->deleteBuffer(m_indexBuffer);
+	device->deleteVertexArray(m_vao);
 }
 
-void RendererSystem::initComponent(Renderable& renderable, const Texture& texture, glm::vec2 tileDimensions, unsigned int shaderID, unsigned int uvOffsetIndex, glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH])
+void RendererSystem::initComponent(Renderable& renderable, const Texture& texture, glm::vec2 tileDimensions, unsigned int shaderID, unsigned int uvOffsetIndex, glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH],
+	unsigned int frameCount, float frameRate)
 {
+	assert(frameCount > 0 && frameCount <= MAX_ANIMATION_LENGTH);
+
 	renderable.texture = texture;
 	renderable.tileDimensions = tileDimensions;
 	renderable.shaderID = shaderID;
 	renderable.uvOffsetIndex = uvOffsetIndex;
+	renderable.frameCount = frameCount;
+	renderable.frameRate = frameRate;
 	
 	if (uvOffsets)
 		memcpy_s(renderable.uvOffsets, sizeof(glm::vec2) * MAX_ANIMATION_LENGTH, uvOffsets, sizeof(glm::vec2) * MAX_ANIMATION_LENGTH);
@@ -84,6 +112,13 @@ void RendererSystem::destroyComponent(Renderable& renderable)
 {
 }
 
+void RendererSystem::setTexture(size_t entityID, const Texture& texture, size_t componentIndex)
+{
+	Renderable* renderable = getComponentNonConst(entityID, componentIndex);
+	if (renderable)
+		renderable->texture = texture;
+}
+
 unsigned int RendererSystem::getVertexBufferID() const
 {
 	return m_vertexBuffer;
@@ -94,58 +129,225 @@ unsigned int RendererSystem::getIndexBufferID() const
 	return m_indexBuffer;
 }
 
+void RendererSystem::clear()
+{
+	RenderQueue::getInstance()->record(this, COMMAND_CLEAR, 0);
+}
+
+void RendererSystem::setViewport(int width, int height)
+{
+	ViewportCommand* command = RenderQueue::getInstance()->record<ViewportCommand>(this, COMMAND_VIEWPORT);
+	command->width = width;
+	command->height = height;
+}
+
+void RendererSystem::uploadCamera(const Camera& camera)
+{
+	CameraUniforms* cameraUniforms = RenderQueue::getInstance()->record<CameraUniforms>(this, COMMAND_CAMERA);
+	cameraUniforms->viewProjection = camera.getViewProjectionMatrix();
+	cameraUniforms->viewPosition = camera.getViewPosition();
+	cameraUniforms->viewSize = camera.getViewSize();
+}
+
 void RendererSystem::render(const Camera& camera)
 {
-	const glm::mat4& projection = camera.getProjectionMatrix();
-	const glm::mat4& view = camera.getViewMatrix();
+	buildBatches(camera);
 
-	glBindVertexArray(m_vao);
+	// The batches and their instances are copied into the command, so the render thread never touches the components
+	size_t extraDataSize = sizeof(SpriteBatch) * m_batches.size() + sizeof(SpriteInstance) * m_batchEntries.size();
+	SpritesCommand* command = RenderQueue::getInstance()->record<SpritesCommand>(this, COMMAND_SPRITES, extraDataSize);
+	command->batchCount = (unsigned int)m_batches.size();
+	command->instanceCount = (unsigned int)m_batchEntries.size();
 
-	for (size_t i = 0; i < m_components.size(); i++)
+	SpriteBatch* batches = reinterpret_cast<SpriteBatch*>(command + 1);
+	SpriteInstance* instances = reinterpret_cast<SpriteInstance*>(batches + m_batches.size());
+
+	if (!m_batches.empty())
+		memcpy_s(batches, sizeof(SpriteBatch) * m_batches.size(), m_batches.data(), sizeof(SpriteBatch) * m_batches.size());
+
+	for (size_t i = 0; i < m_batchEntries.size(); i++)
 	{
-		// Cache transform
-		const Transform* transform = TransformSystem::getInstance()->getComponent(m_components[i].entityID);
-		if (transform)
-		{
-			glm::vec2 position = transform->position;
-			glm::vec2 size = transform->size;
+		instances[i] = m_batchEntries[i].instance;
+	}
+}
+
+void RendererSystem::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->setRenderPass(type == COMMAND_SPRITES ? RENDER_PASS_SPRITES : RENDER_PASS_FRAME);
+
+	switch (type)
+	{
+	case COMMAND_CLEAR:
+		device->clear(GL_COLOR_BUFFER_BIT);
+		break;
+	case COMMAND_VIEWPORT:
+	{
+		const ViewportCommand* command = static_cast<const ViewportCommand*>(data);
+		device->viewport(0, 0, command->width, command->height);
+		break;
+	}
+	case COMMAND_CAMERA:
+		device->bindBuffer(GL_UNIFORM_BUFFER, m_cameraBuffer);
+		device->bufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), data);
+		device->bindBuffer(GL_UNIFORM_BUFFER, 0);
+		device->bindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BUFFER_BINDING, m_cameraBuffer);
+		break;
+	case COMMAND_SPRITES:
+		executeSprites(*static_cast<const SpritesCommand*>(data));
+		break;
+	}
+}
+
+void RendererSystem::executeSprites(const SpritesCommand& command)
+{
+	if (command.batchCount == 0)
+	{
+		m_uploadBuffer->endFrame();
+		return;
+	}
+
+	const SpriteBatch* batches = reinterpret_cast<const SpriteBatch*>(&command + 1);
+	const SpriteInstance* instances = reinterpret_cast<const SpriteInstance*>(batches + command.batchCount);
 
-			// Cache renderable
-			const Renderable& renderable = m_components[i];
-			unsigned int shaderID = renderable.shaderID;
-			const Texture& texture = renderable.texture;
-			glm::vec2 tileDimensions = renderable.tileDimensions;
-			const glm::vec2* uvOffsets = renderable.uvOffsets;
-			unsigned int uvOffsetIndex = renderable.uvOffsetIndex;
+	// Stream every sprite's instance data to the GPU at once
+	if (command.instanceCount > m_instanceCapacity)
+		resizeInstanceBuffer(std::max((size_t)command.instanceCount, m_instanceCapacity * 2));
 
-			// Don't render sprites with no shader
-			if (shaderID == 0) continue;
+	m_uploadBuffer->upload(m_instanceBuffer, 0, instances, sizeof(SpriteInstance) * command.instanceCount);
 
-			// Use the shader
-			glUseProgram(shaderID);
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindVertexArray(m_vao);
+
+	// Each batch is drawn with a single instanced call, and state is only changed between batches when it differs.
+	// The camera comes from the camera uniform buffer, so there are no matrices to upload.
+	unsigned int currentShaderID = 0;
+	unsigned int currentTextureID = 0;
+	for (size_t i = 0; i < command.batchCount; i++)
+	{
+		const SpriteBatch& batch = batches[i];
+
+		if (batch.shaderID != currentShaderID)
+		{
+			currentShaderID = batch.shaderID;
+			device->useProgram(currentShaderID);
 
 			// Upload a tint color
-			glUniform4f(5, 1.0f, 1.0f, 1.0f, 1.0f);
+			device->uniform4f(5, 1.0f, 1.0f, 1.0f, 1.0f);
+		}
 
-			// Build the sprite's world matrix
-			glm::mat4 world = glm::mat4();
-			world = glm::translate(world, glm::vec3(position, 0.0f));
-			world = glm::scale(world, glm::vec3(size, 0.0f));
+		if (batch.textureID != currentTextureID)
+		{
+			currentTextureID = batch.textureID;
+			device->bindTexture(currentTextureID);
+		}
 
-			// Upload uniforms
-			glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
-			glUniformMatrix4fv(1, 1, GL_FALSE, &view[0][0]);
-			glUniformMatrix4fv(2, 1, GL_FALSE, &world[0][0]);
+		device->drawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, batch.instanceCount, batch.firstInstance);
+	}
 
-			glm::vec2 uvOffsetScaleFactor = texture.dimensions / (tileDimensions - glm::vec2(TEXTURE_SHRINK_FACTOR));
-			glUniform2fv(4, 1, &uvOffsetScaleFactor[0]);
-			glUniform2fv(6, 1, &uvOffsets[uvOffsetIndex][0]);
+	m_uploadBuffer->endFrame();
+}
 
-			// Bind the texture
-			glBindTexture(GL_TEXTURE_2D, texture.id);
+const CullStats& RendererSystem::getLastFrameCullStats() const
+{
+	return m_cullStats;
+}
+
+void RendererSystem::buildBatches(const Camera& camera)
+{
+	m_batchEntries.clear();
+	m_batches.clear();
+	m_cullStats = CullStats();
 
-			// Draw the quad
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, (void*)0);
+	// Only the entities in the grid cells the camera can see are considered, so the cost scales with what's on screen
+	glm::vec2 viewPosition = camera.getViewPosition();
+	glm::vec2 viewSize = camera.getViewSize();
+	TransformSystem* transformSystem = TransformSystem::getInstance();
+	transformSystem->queryRect(viewPosition - viewSize * 0.5f, viewPosition + viewSize * 0.5f, m_visibleEntityIDs);
+
+	for (size_t i = 0; i < m_visibleEntityIDs.size(); i++)
+	{
+		size_t entityID = m_visibleEntityIDs[i];
+
+		// Like before, a renderable uses its entity's first transform
+		const Transform* transform = transformSystem->getComponent(entityID);
+		if (!transform) continue;
+
+		// The grid cells are coarse, so check the sprite itself is on screen
+		glm::vec2 distance = glm::abs(transform->position - viewPosition) * 2.0f;
+		bool isOnScreen = distance.x <= viewSize.x + transform->size.x && distance.y <= viewSize.y + transform->size.y;
+
+		auto itPair = getIterators(entityID);
+		for (auto it = itPair.first; it != itPair.second; it++)
+		{
+			const Renderable& renderable = *it;
+
+			// Don't render sprites with no shader, or whose texture is still loading
+			if (renderable.shaderID == 0 || renderable.texture.id == 0) continue;
+
+			// Only sprites rejected by the check above count as culled, not ones that could never be drawn
+			if (!isOnScreen)
+			{
+				m_cullStats.culledCount++;
+				continue;
+			}
+
+			SpriteBatchEntry entry;
+			entry.key = ((uint64_t)renderable.shaderID << 32) | renderable.texture.id;
+			entry.instance.position = transform->position;
+			entry.instance.size = transform->size;
+			entry.instance.uvOffset = renderable.texture.getUVOffset(renderable.uvOffsets[renderable.uvOffsetIndex], renderable.tileDimensions);
+			entry.instance.uvOffsetScaleFactor = renderable.texture.getUVOffsetScaleFactor(renderable.tileDimensions);
+
+			m_batchEntries.push_back(entry);
 		}
 	}
+
+	m_cullStats.drawnCount = m_batchEntries.size();
+
+	// The visible entities are in ID order and the sort is stable, so sprites in the same batch are still drawn in entity order
+	std::stable_sort(m_batchEntries.begin(), m_batchEntries.end(), [](const SpriteBatchEntry& entry1, const SpriteBatchEntry& entry2)
+	{
+		return entry1.key < entry2.key;
+	});
+
+	for (size_t i = 0; i < m_batchEntries.size(); i++)
+	{
+		const SpriteBatchEntry& entry = m_batchEntries[i];
+
+		if (m_batches.empty() || ((uint64_t)m_batches.back().shaderID << 32 | m_batches.back().textureID) != entry.key)
+		{
+			SpriteBatch batch;
+			batch.shaderID = (unsigned int)(entry.key >> 32);
+			batch.textureID = (unsigned int)(entry.key & 0xFFFFFFFF);
+			batch.firstInstance = (unsigned int)i;
+			batch.instanceCount = 0;
+			m_batches.push_back(batch);
+		}
+
+		m_batches.back().instanceCount++;
+	}
+}
+
+void RendererSystem::resizeInstanceBuffer(size_t instanceCapacity)
+{
+	m_instanceCapacity = instanceCapacity;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(SpriteInstance) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+
+	// Position and size
+	device->enableVertexAttribArray(2);
+	device->vertexAttribPointer(2, 4, GL_FLOAT, false, sizeof(SpriteInstance), 0);
+	device->vertexAttribDivisor(2, 1);
+
+	// Uv offset and scale factor
+	device->enableVertexAttribArray(3);
+	device->vertexAttribPointer(3, 4, GL_FLOAT, false, sizeof(SpriteInstance), sizeof(glm::vec2) * 2);
+	device->vertexAttribDivisor(3, 1);
+
+	device->bindVertexArray(0);
 }
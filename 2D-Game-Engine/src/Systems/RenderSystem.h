@@ -1,11 +1,12 @@
 #pragma once
 #include "System.h"
 
-// The amount that should be subtracted from the texture dimensions when rendering to fix gridlike artifacts
-#define TEXTURE_SHRINK_FACTOR FLT_EPSILON * 10
+#define CAMERA_UNIFORM_BUFFER_BINDING 0 // The uniform buffer binding point every shader reads the camera from
+#define SPRITE_UPLOAD_RING_BUFFER_SIZE (16 * 1024 * 1024) // The size of the ring buffer sprite instances are streamed through in bytes
 
 #include "../Components/Renderable.h"
 #include "../Camera.h"
+#include "../RenderQueue.h"
 
 struct Vertex
 {
@@ -13,24 +14,121 @@ struct Vertex
 	glm::vec2 uv;
 };
 
+// The camera data shared by every shader, laid out to match the camera uniform block (std140)
+struct CameraUniforms
+{
+	glm::mat4 viewProjection;
+	glm::vec2 viewPosition;
+	glm::vec2 viewSize;
+};
+
+// A sprite's per-instance data in the instance buffer
+struct SpriteInstance
+{
+	glm::vec2 position;
+	glm::vec2 size;
+	glm::vec2 uvOffset;
+	glm::vec2 uvOffsetScaleFactor;
+};
+
+// A sprite waiting to be batched. The key sorts sprites by shader and then texture, so each batch is one draw call.
+struct SpriteBatchEntry
+{
+	uint64_t key;
+	SpriteInstance instance;
+};
+
+// How many things were drawn and how many were skipped for being off screen in a frame
+struct CullStats
+{
+	CullStats() : drawnCount(0), culledCount(0) {}
+
+	size_t drawnCount;
+	size_t culledCount;
+};
+
+// A run of instances in the instance buffer that share a shader and a texture
+struct SpriteBatch
+{
+	unsigned int shaderID;
+	unsigned int textureID;
+	unsigned int firstInstance;
+	unsigned int instanceCount;
+};
+
 class Terrain;
+class UploadRingBuffer;
 
-class RendererSystem : public System<RendererSystem, Renderable>
+// Records the frame's clear, camera and sprite batches into the render queue, and executes them on the render thread
+class RendererSystem : public System<RendererSystem, Renderable>, public RenderCommandHandler
 {
 public:
 	RendererSystem();
 	~RendererSystem();
 
-	void initComponent(Renderable& renderable, const Texture& texture, glm::vec2 tileDimensions, unsigned int shaderID, unsigned int uvOffsetIndex, glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH]);
+	void initComponent(Renderable& renderable, const Texture& texture, glm::vec2 tileDimensions, unsigned int shaderID, unsigned int uvOffsetIndex, glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH],
+		unsigned int frameCount = 1, float frameRate = 0.0f);
 	void destroyComponent(Renderable& renderable);
 
+	// For textures that load asynchronously. Sprites aren't drawn until their texture has loaded.
+	void setTexture(size_t entityID, const Texture& texture, size_t componentIndex = 0);
+
 	unsigned int getVertexBufferID() const;
 	unsigned int getIndexBufferID() const;
 
+	void clear();
+	void setViewport(int width, int height);
+	void uploadCamera(const Camera& camera);
 	void render(const Camera& camera);
 
+	const CullStats& getLastFrameCullStats() const;
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
+
 private:
+	enum CommandType
+	{
+		COMMAND_CLEAR,
+		COMMAND_VIEWPORT,
+		COMMAND_CAMERA,
+		COMMAND_SPRITES
+	};
+
+	struct ViewportCommand
+	{
+		int width;
+		int height;
+	};
+
+	// Followed by the batches, and then every batch's instances
+	struct SpritesCommand
+	{
+		unsigned int batchCount;
+		unsigned int instanceCount;
+	};
+
+	void executeSprites(const SpritesCommand& command);
+
+	void buildBatches(const Camera& camera);
+	void resizeInstanceBuffer(size_t instanceCapacity);
+
 	unsigned int m_vao;
 	unsigned int m_vertexBuffer;
 	unsigned int m_indexBuffer;
+
+	// Only used on the render thread once it has started
+	unsigned int m_cameraBuffer;
+
+	unsigned int m_instanceBuffer;
+	size_t m_instanceCapacity;
+
+	UploadRingBuffer* m_uploadBuffer;
+
+	// Only used by the simulation
+	CullStats m_cullStats;
+
+	// Kept between frames so they don't have to be reallocated
+	std::vector<size_t> m_visibleEntityIDs;
+	std::vector<SpriteBatchEntry> m_batchEntries;
+	std::vector<SpriteBatch> m_batches;
 };
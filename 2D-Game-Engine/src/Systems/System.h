@@ -13,6 +13,7 @@ public:
 	size_t addComponent(size_t entityID, Args... args);
 	const ComponentType* getComponent(size_t entityID, size_t componentIndex = 0);
 	const std::vector<const ComponentType*> getComponents(size_t entityID);
+	const std::vector<ComponentType>& getAllComponents() const;
 	bool removeComponent(size_t entityID, size_t componentIndex = 0);
 
 protected:
@@ -21,12 +22,11 @@ protected:
 	void destroyComponent(ComponentType& transform);
 
 	ComponentType* getComponentNonConst(size_t entityID, size_t componentIndex);
+	std::pair<typename std::vector<ComponentType>::iterator, typename std::vector<ComponentType>::iterator> getIterators(size_t entityID);
 
 	std::vector<ComponentType> m_components;
 
 private:
-	std::pair<typename std::vector<ComponentType>::iterator, typename std::vector<ComponentType>::iterator> getIterators(size_t entityID);
-
 	static SystemType* m_instance;
 };
 
@@ -106,6 +106,12 @@ inline const std::vector<const ComponentType*> System<SystemType, ComponentType>
 	}
 }
 
+template<typename SystemType, typename ComponentType>
+inline const std::vector<ComponentType>& System<SystemType, ComponentType>::getAllComponents() const
+{
+	return m_components;
+}
+
 template<typename SystemType, typename ComponentType>
 inline bool System<SystemType, ComponentType>::removeComponent(size_t entityID, size_t componentIndex)
 {
@@ -1,14 +1,21 @@
 #include "stdafx.h"
 #include "TransformSystem.h"
 
+TransformSystem::~TransformSystem()
+{
+	// System's destructor destroys the components after the grid is gone, so they're removed here instead
+	m_spatialGrid.clear();
+	m_components.clear();
+}
+
 void TransformSystem::translate(size_t entityID, glm::vec2 delta, size_t componentIndex)
 {
 	Transform* transform = getComponentNonConst(entityID, componentIndex);
 	if(transform)
 	{
 		transform->position += delta;
+		updateSpatialGrid(*transform, componentIndex);
 	}
-	
 }
 
 void TransformSystem::resize(size_t entityID, glm::vec2 delta, size_t componentIndex)
@@ -17,6 +24,7 @@ void TransformSystem::resize(size_t entityID, glm::vec2 delta, size_t componentI
 	if (transform)
 	{
 		transform->size += delta;
+		updateSpatialGrid(*transform, componentIndex);
 	}
 }
 
@@ -26,6 +34,7 @@ void TransformSystem::setPosition(size_t entityID, glm::vec2 position, size_t co
 	if (transform)
 	{
 		transform->position = position;
+		updateSpatialGrid(*transform, componentIndex);
 	}
 }
 
@@ -35,15 +44,64 @@ void TransformSystem::setSize(size_t entityID, glm::vec2 size, size_t componentI
 	if (transform)
 	{
 		transform->size = size;
+		updateSpatialGrid(*transform, componentIndex);
 	}
 }
 
+void TransformSystem::shiftOrigin(glm::vec2 worldDelta)
+{
+	for (size_t i = 0; i < m_components.size(); i++)
+	{
+		m_components[i].position -= worldDelta;
+	}
+
+	// Every entity has moved, so the grid is rebuilt around the new origin
+	m_spatialGrid.clear();
+	for (size_t i = 0; i < m_components.size(); i++)
+	{
+		if (i == 0 || m_components[i - 1].entityID != m_components[i].entityID)
+			m_spatialGrid.update(m_components[i].entityID, m_components[i].position, m_components[i].size);
+	}
+}
+
+void TransformSystem::queryRect(glm::vec2 min, glm::vec2 max, std::vector<size_t>& entityIDs) const
+{
+	m_spatialGrid.query(min, max, entityIDs);
+}
+
+void TransformSystem::updateSpatialGrid(const Transform& transform, size_t componentIndex)
+{
+	if (componentIndex == 0)
+		m_spatialGrid.update(transform.entityID, transform.position, transform.size);
+}
+
 void TransformSystem::initComponent(Transform& transform, glm::vec2 position, glm::vec2 size)
 {
 	transform.position = position;
 	transform.size = size;
+
+	// Only the entity's first transform is kept in the grid
+	if (getComponent(transform.entityID) == &transform)
+		m_spatialGrid.update(transform.entityID, position, size);
 }
 
 void TransformSystem::destroyComponent(Transform& transform)
 {
+	if (getComponent(transform.entityID) == &transform)
+		m_spatialGrid.remove(transform.entityID);
+}
+
+bool TransformSystem::removeComponent(size_t entityID, size_t componentIndex)
+{
+	if (!System::removeComponent(entityID, componentIndex)) return false;
+
+	// The entity's next transform is now its first, so it takes the removed one's place in the grid
+	if (componentIndex == 0)
+	{
+		const Transform* transform = getComponent(entityID);
+		if (transform)
+			m_spatialGrid.update(entityID, transform->position, transform->size);
+	}
+
+	return true;
 }
@@ -2,16 +2,32 @@
 #include "System.h"
 
 #include "../Components/Transform.h"
+#include "../SpatialGrid.h"
 
 class TransformSystem : public System<TransformSystem, Transform>
 {
 public:
+	~TransformSystem();
+
 	void initComponent(Transform& transform, glm::vec2 position, glm::vec2 size);
 	void destroyComponent(Transform& transform);
 
+	// Hides System::removeComponent, so an entity whose first transform is removed stays in the grid under its next one
+	bool removeComponent(size_t entityID, size_t componentIndex = 0);
+
 	void translate(size_t entityID, glm::vec2 delta, size_t componentIndex = 0);
 	void resize(size_t entityID, glm::vec2 delta, size_t componentIndex = 0);
 
 	void setPosition(size_t entityID, glm::vec2 position, size_t componentIndex = 0);
 	void setSize(size_t entityID, glm::vec2 size, size_t componentIndex = 0);
+
+	void shiftOrigin(glm::vec2 worldDelta);
+
+	void queryRect(glm::vec2 min, glm::vec2 max, std::vector<size_t>& entityIDs) const;
+
+private:
+	void updateSpatialGrid(const Transform& transform, size_t componentIndex);
+
+	// Holds each entity's first transform, which is the one other systems use for the entity
+	SpatialGrid m_spatialGrid;
 };
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "stdafx.h"
 #include "Terrain.h"
 
+#include <thread>
+#include <limits>
+
+#include "ParticleSystem.h"
+
 #ifdef _DEBUG
 #include "Input.h"
 #endif
@@ -41,15 +46,19 @@ std::vector<std::vector<std::vector<BlockType>>> Terrain::s_treePatterns =
 	}
 };
 
-Terrain::Terrain(b2World& physicsWorld, glm::vec2 startingPosition, unsigned int vertexBufferID, unsigned int indexBufferID)
-	: m_physicsWorld(physicsWorld)
+Terrain::Terrain(b2World& physicsWorld, const Camera& camera, unsigned int indexBufferID)
+	: m_physicsWorld(physicsWorld), m_nextObserverID(0)
 {
-	m_terrainRenderer = new TerrainRenderer(this, vertexBufferID, indexBufferID);
+	m_terrainRenderer = new TerrainRenderer(this, indexBufferID);
 
 	m_terrainNoise = new SimplexNoise(0.25f);
 	m_treeNoise = new SimplexNoise(4.0f, 0.25f);
 
-	genStartingChunks(startingPosition);
+	typedef ChunkLayout<CHUNK_SIZE> Layout;
+	Output::log("Chunk layout: " + std::to_string(Layout::size) + "x" + std::to_string(Layout::size) + " blocks, " +
+		std::to_string(sizeof(Chunk)) + " bytes per chunk, " + std::to_string(Layout::uploadBytes) + " bytes uploaded per chunk");
+
+	genStartingChunks(camera);
 }
 
 Terrain::~Terrain()
@@ -80,102 +89,160 @@ Terrain::~Terrain()
 	delete m_terrainRenderer;
 }
 
-void Terrain::cameraUpdate(const Camera& camera)
+size_t Terrain::addObserver(glm::vec2 position, glm::vec2 viewSize, int genRadius, int unloadRadius)
 {
-#ifdef _DEBUG
-	m_terrainRenderer->update(camera);
+	size_t observerID = m_nextObserverID++;
 
-	if (Input::getInstance()->isKeyPressed(GLFW_KEY_R))
+	ChunkObserver& observer = m_observers[observerID];
+	observer.position = position;
+	observer.viewSize = viewSize;
+	observer.velocity = glm::vec2();
+	observer.genRadius = genRadius;
+	observer.unloadRadius = unloadRadius;
+
+	// Take the observer's initial tickets and generate the chunks around it
+	refreshObserver(observer, true);
+
+	return observerID;
+}
+
+void Terrain::updateObserver(size_t observerID, glm::vec2 position, glm::vec2 viewSize, glm::vec2 velocity)
+{
+	auto it = m_observers.find(observerID);
+	if (it == m_observers.end())
 	{
-		genStartingChunks(camera.getPosition());
+		Output::error("ERROR: Tried to update chunk observer " + std::to_string(observerID) + " but it doesn't exist.");
+		return;
 	}
-#endif
 
-	// Check if the camera has moved outside of the visible chunk range and the chunk containers should be shifted
-	std::vector<Chunk*> chunksToQueue = m_terrainRenderer->checkShiftChunkContainers(camera);
-	if (!chunksToQueue.empty())
-		queueGenChunks(chunksToQueue);
+	ChunkObserver& observer = it->second;
+	observer.position = position;
+	observer.viewSize = viewSize;
+	observer.velocity = velocity;
 
-	// Check if chunks should be generated
-	checkGenChunks(camera);
+	refreshObserver(observer, false);
+}
 
-	// Check for chunks that are too far away from the player and should be unloaded
-	checkUnloadChunks(camera);
+void Terrain::removeObserver(size_t observerID)
+{
+	auto it = m_observers.find(observerID);
+	if (it == m_observers.end())
+	{
+		Output::error("ERROR: Tried to remove chunk observer " + std::to_string(observerID) + " but it doesn't exist.");
+		return;
+	}
+
+	// Give back all of the observer's tickets
+	moveTickets(it->second.ticketRect, ChunkRect());
+	m_observers.erase(it);
 }
 
-void Terrain::update()
+void Terrain::cameraUpdate(const Camera& camera)
 {
-	// TEMP - animate grass
-	/*for (size_t k = 0; k < CHUNK_VIEW_SIZE; k++)
+#ifdef _DEBUG
+	m_terrainRenderer->update(camera);
+
+	// Dig out or place blocks under the mouse
+	if (Input::getInstance()->isMouseButtonHeld(GLFW_MOUSE_BUTTON_RIGHT))
+		editBlock(camera.screenToWorld(Input::getInstance()->getMousePosition()), AIR);
+
+	if (Input::getInstance()->isMouseButtonHeld(GLFW_MOUSE_BUTTON_MIDDLE))
+		editBlock(camera.screenToWorld(Input::getInstance()->getMousePosition()), DIRT);
+
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_R))
 	{
-		Chunk& chunk = m_chunkContainers[k];
+		genStartingChunks(camera);
 
-		for (size_t j = 0; j < CHUNK_SIZE; j++)
+		// All of the chunks were thrown away, so every observer needs to generate its chunks again
+		for (auto it = m_observers.begin(); it != m_observers.end(); it++)
 		{
-			for (size_t i = 0; i < CHUNK_SIZE; i++)
-			{
-				if (chunk.blocks[i + j * CHUNK_SIZE].id == GRASS)
-				{
-					chunk.blocks[i + j * CHUNK_SIZE].renderData.uvOffsetIndex =
-						(chunk.blocks[i + j * CHUNK_SIZE].renderData.uvOffsetIndex + 1) % 5;
-				}
-			}
+			refreshObserver(it->second, true);
 		}
+	}
+#endif
+
+	// Give the chunks in and around the camera's view a chunk container, generating any that don't exist yet
+	std::vector<Chunk*> chunksToQueue = m_terrainRenderer->updateChunkContainers(camera);
+	if (!chunksToQueue.empty())
+		queueGenChunks(chunksToQueue);
+}
 
-		updateUVOffsetIndices(&chunk);
-	}*/
+void Terrain::update(float deltaTime)
+{
+	// Animated blocks are stepped on the GPU
+	m_terrainRenderer->advanceAnimationTime(deltaTime);
 
 	// Generate chunks in the queue
 	genChunks();
 
 	// Check if any threads have finished and remove them
 	checkThreadsFinished();
+
+	// Unload the chunks that no observer is interested in anymore
+	checkUnloadChunks();
+
+	// All of this frame's terrain uploads have been made
+	m_terrainRenderer->endFrame();
 }
 
-void Terrain::render(const Camera& camera) const
+void Terrain::render(const Camera& camera)
 {
 	m_terrainRenderer->render(camera);
 }
 
-Chunk* Terrain::createChunk(glm::vec2 chunkPosition)
+const CullStats& Terrain::getLastFrameCullStats() const
 {
-	if (m_chunks.find(chunkPosition) == m_chunks.end())
-	{
-		Chunk* chunk = new Chunk(chunkPosition);
-		m_chunks[chunk->chunkPosition] = chunk;
+	return m_terrainRenderer->getLastFrameCullStats();
+}
 
-		// Initialize the blocks
-		memset(chunk->blocks, 0, CHUNK_SIZE * CHUNK_SIZE);
-		memset(chunk->blockCount, 0, BLOCK_COUNT);
+size_t Terrain::getResidentChunkCount() const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
+	return m_chunks.size();
+}
 
-		// Initialize the chunk's physics body
-		glm::vec2 chunkWorldPosition = chunkToWorldCoords(chunkPosition);
+size_t Terrain::getQueuedGenChunkCount() const
+{
+	std::unique_lock<std::mutex> lock(m_genQueueMutex);
+	return m_queuedChunksToGen.size();
+}
 
-		b2Vec2 scaledPosition = b2Vec2(chunkWorldPosition.x / PHYSICS_PIXELS_PER_METER, chunkWorldPosition.y / PHYSICS_PIXELS_PER_METER);
-		b2Vec2 scaledDimensions = b2Vec2(CHUNK_SIZE * BLOCK_SIZE / PHYSICS_PIXELS_PER_METER, CHUNK_SIZE * BLOCK_SIZE / PHYSICS_PIXELS_PER_METER);
+size_t Terrain::getGenThreadCount() const
+{
+	return m_genChunkThreads.size() + m_postGenThreads.size();
+}
 
-		b2BodyDef bodyDef;
-		bodyDef.position = scaledPosition;
-		bodyDef.type = b2_staticBody;
-		bodyDef.fixedRotation = true;
+void Terrain::shiftOrigin(ChunkCoords chunkDelta)
+{
+	m_originChunk += chunkDelta;
 
-		chunk->physicsObject.body = m_physicsWorld.CreateBody(&bodyDef);
+	// The observers are positioned relative to the origin, so move them with it. Their chunk rects are absolute
+	// and stay the same, so no tickets change hands.
+	glm::vec2 worldDelta = glm::vec2((float)chunkDelta.x, (float)chunkDelta.y) * (float)(CHUNK_SIZE * BLOCK_SIZE);
+	for (auto it = m_observers.begin(); it != m_observers.end(); it++)
+	{
+		it->second.position -= worldDelta;
+	}
+}
 
-		// Add a fixture for each block in the chunk
-		/*for (size_t j = 0; j < CHUNK_SIZE; j++)
-		{
-			for (size_t i = 0; i < CHUNK_SIZE; i++)
-			{
-				b2PolygonShape shape;
-				shape.SetAsBox((BLOCK_SIZE / 2) / PHYSICS_PIXELS_PER_METER, (BLOCK_SIZE / 2) / PHYSICS_PIXELS_PER_METER,
-					b2Vec2((float)i * BLOCK_SIZE + (BLOCK_SIZE / 2) / PHYSICS_PIXELS_PER_METER, (float)j * BLOCK_SIZE + (BLOCK_SIZE / 2) / PHYSICS_PIXELS_PER_METER), 0);
+ChunkCoords Terrain::getOriginChunk() const
+{
+	return m_originChunk;
+}
 
-				b2FixtureDef fixtureDef;
-				fixtureDef.shape = &shape;
+Chunk* Terrain::createChunk(ChunkCoords chunkPosition)
+{
+	// Cave worms create chunks from the post gen threads, so the chunk map needs to be locked
+	std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
 
-				chunk->physicsObject.body->CreateFixture(&fixtureDef);
-			}
-		}*/
+	if (m_chunks.find(chunkPosition) == m_chunks.end())
+	{
+		Chunk* chunk = new Chunk(chunkPosition);
+		m_chunks[chunk->chunkPosition] = chunk;
+
+		// Initialize the blocks
+		memset(chunk->blocks, 0, CHUNK_SIZE * CHUNK_SIZE);
+		memset(chunk->blockCount, 0, BLOCK_COUNT);
 
 		// Initialize the chunk's additional data
 		chunk->chunkType = CHUNK_AIR;
@@ -193,8 +260,10 @@ Chunk* Terrain::createChunk(glm::vec2 chunkPosition)
 	}
 }
 
-Chunk* Terrain::getChunk(glm::vec2 chunkPosition) const
+Chunk* Terrain::getChunk(ChunkCoords chunkPosition) const
 {
+	std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
+
 	auto it = m_chunks.find(chunkPosition);
 	if (it != m_chunks.end())
 		return it->second;
@@ -202,53 +271,221 @@ Chunk* Terrain::getChunk(glm::vec2 chunkPosition) const
 		return nullptr;
 }
 
-void Terrain::genStartingChunks(glm::vec2 startingPosition)
+bool Terrain::editBlock(glm::vec2 worldPosition, BlockType type)
 {
-	// Deletes any old chunks for a fresh start
-	unloadChunks();
+	// Blocks are centered on their position, so round to the nearest block
+	int64_t blockX = (int64_t)floorf(worldPosition.x / BLOCK_SIZE + 0.5f);
+	int64_t blockY = (int64_t)floorf(worldPosition.y / BLOCK_SIZE + 0.5f);
+
+	ChunkCoords localChunkPosition = ChunkCoords::fromBlock(blockX, blockY, CHUNK_SIZE);
+	Chunk* chunk = getChunk(m_originChunk + localChunkPosition);
 
-	glm::vec2 offset = worldToChunkCoords(startingPosition);
+	// Chunks that are still generating would overwrite the edit
+	if (!chunk || !chunk->hasFullyLoaded) return false;
 
-	int initialX = (int)(offset.x + (-CHUNK_CONTAINER_DISTANCE / 2.0f));
-	int initialY = (int)(offset.y + (-CHUNK_CONTAINER_DISTANCE / 2.0f));
+	int i = (int)(blockX - localChunkPosition.x * CHUNK_SIZE);
+	int j = (int)(blockY - localChunkPosition.y * CHUNK_SIZE);
 
-	// Create empty chunks that need to be generated
-	std::vector<Chunk*> startingChunks;
-	unsigned int index = 0;
-	for (int y = initialY; y < initialY + (CHUNK_CONTAINER_DISTANCE + 1); y++)
+	BlockType previousType;
 	{
-		for (int x = initialX; x < initialX + (CHUNK_CONTAINER_DISTANCE + 1); x++)
+		std::unique_lock<std::mutex> lock(chunk->mutex);
+
+		// Editing is repeated every frame while the mouse is held, so nothing is rebuilt unless the block changes
+		Block& block = chunk->blocks[i + j * CHUNK_SIZE];
+		if (block.blockType == type) return false;
+
+		previousType = block.blockType;
+		chunk->blockCount[block.blockType]--;
+		chunk->blockCount[type]++;
+
+		setBlock(block, type, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
+
+		// Only the instances the block affects are rebuilt, instead of the whole chunk's
+		TerrainRenderer::updateInstances(chunk->blocks, chunk->instances, i, j);
+
+#if TERRAIN_COLLISION
+		if (isSolidBlock(type) != isSolidBlock(previousType))
+			updateChunkCollision(*chunk);
+#endif
+	}
+
+	if (chunk->containerIndex > -1)
+		m_terrainRenderer->updateDrawingBuffers(chunk->containerIndex);
+
+	if (type == AIR && previousType != AIR)
+		spawnBlockDebris(previousType, glm::vec2(blockX * BLOCK_SIZE, blockY * BLOCK_SIZE));
+
+	return true;
+}
+
+void Terrain::updateChunkCollision(Chunk& chunk)
+{
+	// Chunks can be created by the post gen threads, so their bodies are created here instead, on the simulation
+	if (!chunk.physicsObject.body)
+	{
+		glm::vec2 chunkWorldPosition = chunkToWorldCoords(chunk.chunkPosition);
+
+		b2BodyDef bodyDef;
+		bodyDef.position = b2Vec2(chunkWorldPosition.x / PHYSICS_PIXELS_PER_METER, chunkWorldPosition.y / PHYSICS_PIXELS_PER_METER);
+		bodyDef.type = b2_staticBody;
+		bodyDef.fixedRotation = true;
+
+		chunk.physicsObject.body = m_physicsWorld.CreateBody(&bodyDef);
+	}
+
+	b2Body* body = chunk.physicsObject.body;
+
+	b2Fixture* fixture = body->GetFixtureList();
+	while (fixture)
+	{
+		b2Fixture* next = fixture->GetNext();
+		body->DestroyFixture(fixture);
+		fixture = next;
+	}
+
+	// Blocks are centered on their position, so a run from i to runEnd spans half a block past each end's position
+	for (int j = 0; j < CHUNK_SIZE; j++)
+	{
+		int i = 0;
+		while (i < CHUNK_SIZE)
 		{
-			Chunk* chunk = createChunk(glm::vec2(x, y));
-			chunk->containerIndex = index;
+			if (!isSolidBlock(chunk.blocks[i + j * CHUNK_SIZE].blockType))
+			{
+				i++;
+				continue;
+			}
+
+			int runEnd = i;
+			while (runEnd + 1 < CHUNK_SIZE && isSolidBlock(chunk.blocks[(runEnd + 1) + j * CHUNK_SIZE].blockType))
+			{
+				runEnd++;
+			}
+
+			float halfWidth = (runEnd - i + 1) * BLOCK_SIZE * 0.5f;
+			float centerX = (i + runEnd) * BLOCK_SIZE * 0.5f;
+
+			b2PolygonShape shape;
+			shape.SetAsBox(halfWidth / PHYSICS_PIXELS_PER_METER, BLOCK_SIZE * 0.5f / PHYSICS_PIXELS_PER_METER,
+				b2Vec2(centerX / PHYSICS_PIXELS_PER_METER, j * BLOCK_SIZE / PHYSICS_PIXELS_PER_METER), 0.0f);
+
+			b2FixtureDef fixtureDef;
+			fixtureDef.shape = &shape;
+			body->CreateFixture(&fixtureDef);
 
-			startingChunks.push_back(chunk);
-			index++;
+			i = runEnd + 1;
 		}
 	}
+}
+
+bool Terrain::isSolidBlock(BlockType type)
+{
+	// Trees are scenery that can be walked through
+	return type == DIRT || type == GRASS || type == STONE;
+}
 
-	// Initialize the chunk containers for rendering with the starting chunks
-	m_terrainRenderer->initChunkContainers(startingChunks, offset);
+void Terrain::spawnBlockDebris(BlockType type, glm::vec2 worldPosition)
+{
+	ParticleSystem* particleSystem = ParticleSystem::getInstance();
+	if (!particleSystem) return;
+
+	// Chips of the block's texture that jump up out of where it was and fall back down
+	const Renderable& renderData = BlockContainer::getBlockRenderData(type);
+
+	ParticleEmitter debris;
+	debris.texture = renderData.texture;
+	debris.tileDimensions = renderData.tileDimensions;
+	debris.uvOffset = renderData.uvOffsets[0];
+	debris.lifetimeMin = 0.4f;
+	debris.lifetimeMax = 0.8f;
+	debris.speedMin = 60.0f;
+	debris.speedMax = 180.0f;
+	debris.direction = glm::half_pi<float>();
+	debris.spread = glm::quarter_pi<float>();
+	debris.sizeMin = 3.0f;
+	debris.sizeMax = 6.0f;
+	debris.gravity = PHYSICS_GRAVITY * PHYSICS_PIXELS_PER_METER;
+	debris.spawnExtents = glm::vec2(BLOCK_SIZE * 0.5f);
+
+	particleSystem->burst(debris, worldPosition, BLOCK_DEBRIS_COUNT);
+}
+
+void Terrain::genStartingChunks(const Camera& camera)
+{
+	// Deletes any old chunks for a fresh start, after taking them out of the chunk containers
+	m_terrainRenderer->releaseContainers();
+	unloadChunks();
+
+	// Give the chunks in and around the camera's view containers, creating the empty chunks that need to be generated
+	std::vector<Chunk*> startingChunks = m_terrainRenderer->updateChunkContainers(camera);
 
 	// Adds the chunk info to the queue
 	queueGenChunks(startingChunks);
+
+	std::vector<Chunk*> warmUpChunkList = startingChunks;
+
+#if WARM_UP_GEN_BUFFER
+	// Also create the rest of the gen buffer so the player doesn't see it stream in right after startup
+	ChunkCoords offset = worldToChunkCoords(camera.getPosition());
+	std::vector<Chunk*> genBufferChunks;
+	for (int64_t y = offset.y - CAMERA_VIEW_BUFFER_GEN; y <= offset.y + CAMERA_VIEW_BUFFER_GEN; y++)
+	{
+		for (int64_t x = offset.x - CAMERA_VIEW_BUFFER_GEN; x <= offset.x + CAMERA_VIEW_BUFFER_GEN; x++)
+		{
+			ChunkCoords chunkPosition = ChunkCoords(x, y);
+			if (!getChunk(chunkPosition))
+				genBufferChunks.push_back(createChunk(chunkPosition));
+		}
+	}
+
+	queueGenChunks(genBufferChunks);
+	warmUpChunkList.insert(warmUpChunkList.end(), genBufferChunks.begin(), genBufferChunks.end());
+#endif
+
+	// Generate the chunks before the first frame so it isn't rendered with an empty screen
+	warmUpChunks(warmUpChunkList);
 }
 
-void Terrain::genChunks()
+void Terrain::warmUpChunks(const std::vector<Chunk*>& chunks)
 {
-	std::unique_lock<std::mutex> lock(m_genQueueMutex);
+	auto startTime = std::chrono::high_resolution_clock::now();
 
-	// Take some chunk info from the queue and start a thread to generate the chunk
-	if (m_queuedChunksToGen.size() > 0)
+	bool hasFullyLoaded = false;
+	while (!hasFullyLoaded)
 	{
-		Chunk* chunk = m_queuedChunksToGen.front();
+		// Start every queued chunk at once instead of one per frame, so the generation is spread across all cores.
+		// This also picks up any chunks that were queued by cave worms during post gen.
+		genChunks(std::numeric_limits<size_t>::max());
 
-		// Generate the chunk in its own thread
-		m_genChunkThreads.push_back(std::async(std::launch::async, &Terrain::genChunkThreaded, this, chunk));
+		// Starts the post gen threads and uploads the chunks that have finished
+		checkThreadsFinished();
+
+		hasFullyLoaded = std::all_of(chunks.begin(), chunks.end(), [](const Chunk* chunk)
+		{
+			return chunk->hasFullyLoaded;
+		});
 
-		// Remove the chunk info from the queue
-		m_queuedChunksToGen.erase(m_queuedChunksToGen.begin());
+		if (!hasFullyLoaded)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
+
+	std::chrono::duration<float, std::milli> warmUpTime = std::chrono::high_resolution_clock::now() - startTime;
+	Output::log("Warmed up " + std::to_string(chunks.size()) + " chunks in " + std::to_string(warmUpTime.count()) + " ms");
+}
+
+void Terrain::genChunks(size_t maxChunks)
+{
+	std::unique_lock<std::mutex> lock(m_genQueueMutex);
+
+	// Take some chunk info from the queue and start a thread to generate each chunk
+	size_t chunkCount = std::min(maxChunks, m_queuedChunksToGen.size());
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		// Generate the chunk in its own thread
+		m_genChunkThreads.push_back(std::async(std::launch::async, &Terrain::genChunkThreaded, this, m_queuedChunksToGen[i]));
+	}
+
+	// Remove the chunk info from the queue
+	m_queuedChunksToGen.erase(m_queuedChunksToGen.begin(), m_queuedChunksToGen.begin() + chunkCount);
 }
 
 void Terrain::queueGenChunk(Chunk* chunk)
@@ -265,15 +502,13 @@ void Terrain::queueGenChunks(const std::vector<Chunk*>& chunks)
 
 Chunk* Terrain::genChunkThreaded(Chunk* chunk)
 {
-	glm::vec2 chunkWorldPosition = chunkToWorldCoords(chunk->chunkPosition);
+	// Generation uses the chunk's absolute position in double precision so that the terrain is the same no matter where the origin is
+	glm::dvec2 chunkWorldPosition = chunkToAbsoluteCoords(chunk->chunkPosition);
 
 	// Allocate memory to put the generated chunk into
 	Block* blocks = new Block[CHUNK_SIZE * CHUNK_SIZE];
 	unsigned int blockCount[BLOCK_COUNT] = {};
 
-	// Allocate memory for the block index map
-	unsigned int blockIndexMap[CHUNK_SIZE * CHUNK_SIZE];
-
 	// Calculate the surface height values
 	int surfaceHeights[CHUNK_SIZE];
 	for (size_t i = 0; i < CHUNK_SIZE; i++)
@@ -289,40 +524,38 @@ Chunk* Terrain::genChunkThreaded(Chunk* chunk)
 		for (size_t i = 0; i < CHUNK_SIZE; i++)
 		{
 			// Cache the block X value
-			int blockX = (int)(chunkWorldPosition.x + i * BLOCK_SIZE);
+			double blockX = chunkWorldPosition.x + i * BLOCK_SIZE;
 
 			size_t blockIndex = i + j * CHUNK_SIZE;
 
-			blockIndexMap[blockIndex] = (unsigned int)blockIndex;
-
 			// Cache the surface height
 			int surfaceHeight = surfaceHeights[i];
 
 			// Generate the stone value
-			int stoneValue = (int)roundf(m_terrainNoise->fractal(STONE_OCTAVES, (blockX + 1) / SMOOTHNESS, (blockY + 1) / SMOOTHNESS) * STONE_FLUX / BLOCK_SIZE) * BLOCK_SIZE;
+			int stoneValue = (int)roundf(m_terrainNoise->fractal(STONE_OCTAVES, (blockX + 1) / SMOOTHNESS, (blockY + 1.0) / SMOOTHNESS) * STONE_FLUX / BLOCK_SIZE) * BLOCK_SIZE;
 
 			// Add a grass block if the we're at the surface value
 			if (blockY == surfaceHeight)
 			{
-				setBlock(blocks[blockIndex], GRASS, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 3);
+				setBlock(blocks[blockIndex], GRASS, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 3);
 				blockCount[GRASS]++;
 			}
 			else if (blockY < surfaceHeight) // Else add a block if the we're below the surface value
 			{
 				if (blockY < surfaceHeight - 8 * BLOCK_SIZE && stoneValue >= STONE_WEIGHT)
 				{
-					setBlock(blocks[blockIndex], STONE, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
+					setBlock(blocks[blockIndex], STONE, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
 					blockCount[STONE]++;
 				}
 				else
 				{
-					setBlock(blocks[blockIndex], DIRT, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
+					setBlock(blocks[blockIndex], DIRT, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
 					blockCount[DIRT]++;
 				}
 			}
 			else // Add an air block if we're above the surface value
 			{
-				setBlock(blocks[blockIndex], AIR, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
+				setBlock(blocks[blockIndex], AIR, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
 				blockCount[AIR]++;
 			}
 		}
@@ -353,13 +586,9 @@ Chunk* Terrain::genChunkThreaded(Chunk* chunk)
 		chunkType = CHUNK_SURFACE;
 
 		// Update grass
-		//updateGrassBlocks(chunkWorldPosition, blocks);
+		//updateGrassBlocks(blocks);
 	}
 
-	// Sort the chunk's block index map so that we can keep the blocks unsorted for later modification,
-	// but still be able to copy them to the drawing buffers in sorted way.
-	sortBlockIndexMap(blocks, blockIndexMap);
-
 	float noiseValue = SimplexNoise::noise(chunkWorldPosition.x / SMOOTHNESS, chunkWorldPosition.y / SMOOTHNESS);
 
 	// Now that the chunk has been generated, copy it to the appropriate chunk reference
@@ -373,7 +602,6 @@ Chunk* Terrain::genChunkThreaded(Chunk* chunk)
 	}
 	
 	memcpy_s(chunk->blocks, sizeof(Block) * CHUNK_SIZE * CHUNK_SIZE, blocks, sizeof(Block) * CHUNK_SIZE * CHUNK_SIZE);
-	memcpy_s(chunk->blockIndexMap, sizeof(unsigned int) * CHUNK_SIZE * CHUNK_SIZE, blockIndexMap, sizeof(unsigned int) * CHUNK_SIZE * CHUNK_SIZE);
 	memcpy_s(chunk->blockCount, sizeof(unsigned int) * BLOCK_COUNT, blockCount, sizeof(unsigned int) * BLOCK_COUNT);
 	chunk->chunkType = chunkType;
 	chunk->hasGenerated = true;
@@ -408,20 +636,37 @@ std::vector<Chunk*> Terrain::postGenChunkThreaded(Chunk* chunk)
 	std::sort(modifiedChunks.begin(), modifiedChunks.end());
 	modifiedChunks.erase(std::unique(modifiedChunks.begin(), modifiedChunks.end()), modifiedChunks.end());
 
+	// Build the modified chunks' instance data here, so the main thread only has to upload it
+	for (size_t i = 0; i < modifiedChunks.size(); i++)
+	{
+		std::unique_lock<std::mutex> lock(modifiedChunks[i]->mutex);
+		TerrainRenderer::buildInstances(modifiedChunks[i]->blocks, modifiedChunks[i]->instances);
+	}
+
 	return modifiedChunks;
 }
 
 void Terrain::unloadChunks()
 {
+	std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
+
 	for (auto it = m_chunks.begin(); it != m_chunks.end(); it++)
 	{
-		delete it->second;
+		destroyChunk(it->second);
 	}
 
 	m_chunks.clear();
 }
 
-void Terrain::updateGrassBlocks(glm::vec2 chunkWorldPosition, Block* blocks)
+void Terrain::destroyChunk(Chunk* chunk)
+{
+	// The body would otherwise stay in the world, colliding where the chunk used to be
+	if (chunk->physicsObject.body)
+		m_physicsWorld.DestroyBody(chunk->physicsObject.body);
+	delete chunk;
+}
+
+void Terrain::updateGrassBlocks(Block* blocks)
 {
 	for (int j = 0; j < CHUNK_SIZE; j++)
 	{
@@ -433,11 +678,11 @@ void Terrain::updateGrassBlocks(glm::vec2 chunkWorldPosition, Block* blocks)
 				// Check if we should use corner grass pieces
 				if (i - 1 >= 0 && blocks[(i - 1) + j * CHUNK_SIZE].blockType == AIR)
 				{
-					setBlock(blocks[blockIndex], GRASS, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 1);
+					setBlock(blocks[blockIndex], GRASS, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 1);
 				}
 				else if (i + 1 < CHUNK_SIZE && blocks[(i + 1) + j * CHUNK_SIZE].blockType == AIR)
 				{
-					setBlock(blocks[blockIndex], GRASS, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 3);
+					setBlock(blocks[blockIndex], GRASS, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 3);
 				}
 			}
 			else if (blocks[blockIndex].blockType == DIRT)
@@ -445,29 +690,29 @@ void Terrain::updateGrassBlocks(glm::vec2 chunkWorldPosition, Block* blocks)
 				// Check if we should use side grass pieces
 				if (i - 1 >= 0 && blocks[(i - 1) + j * CHUNK_SIZE].blockType == AIR)
 				{
-					setBlock(blocks[blockIndex], GRASS, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
+					setBlock(blocks[blockIndex], GRASS, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 0);
 				}
 				else if (i + 1 < CHUNK_SIZE && blocks[(i + 1) + j * CHUNK_SIZE].blockType == AIR)
 				{
-					setBlock(blocks[blockIndex], GRASS, chunkWorldPosition + glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 4);
+					setBlock(blocks[blockIndex], GRASS, glm::vec2(i * BLOCK_SIZE, j * BLOCK_SIZE), 4);
 				}
 			}
 		}
 	}
 }
 
-void Terrain::genCave(Block* blocks, unsigned int blockCount[BLOCK_COUNT], glm::vec2 chunkWorldPosition)
+void Terrain::genCave(Block* blocks, unsigned int blockCount[BLOCK_COUNT], glm::dvec2 chunkAbsolutePosition)
 {
 	for (size_t j = 0; j < CHUNK_SIZE; j++)
 	{
-		int blockY = (int)(chunkWorldPosition.y + j * BLOCK_SIZE);
+		double blockY = chunkAbsolutePosition.y + j * BLOCK_SIZE;
 
 		for (size_t i = 0; i < CHUNK_SIZE; i++)
 		{
-			int blockX = (int)(chunkWorldPosition.x + i * BLOCK_SIZE);
+			double blockX = chunkAbsolutePosition.x + i * BLOCK_SIZE;
 
-			float caveNoise = (m_terrainNoise->fractal(2, blockX * (1.0f / CHUNK_SIZE / 2.0f), blockY * (1.0f / CHUNK_SIZE / 2.0f)));
-			float caveCutoff = 1 - abs(chunkWorldPosition.y * 2 / (TERRAIN_CHUNK_HEIGHT * CHUNK_SIZE * BLOCK_SIZE)) - 0.2f;
+			float caveNoise = (m_terrainNoise->fractal(2, blockX * (1.0 / CHUNK_SIZE / 2.0), blockY * (1.0 / CHUNK_SIZE / 2.0)));
+			float caveCutoff = 1 - (float)fabs(chunkAbsolutePosition.y * 2 / (TERRAIN_CHUNK_HEIGHT * CHUNK_SIZE * BLOCK_SIZE)) - 0.2f;
 			caveCutoff = fmaxf(caveCutoff, -0.25f);
 			if (caveNoise > caveCutoff)
 			{
@@ -480,33 +725,31 @@ void Terrain::genCave(Block* blocks, unsigned int blockCount[BLOCK_COUNT], glm::
 	}
 }
 
-std::vector<Chunk*> Terrain::genCaveWorm(glm::vec2 chunkPosition)
+std::vector<Chunk*> Terrain::genCaveWorm(ChunkCoords chunkPosition)
 {
 	std::vector<Chunk*> modifiedChunks;
 
-	glm::vec2 chunkWorldPosition = chunkToWorldCoords(chunkPosition);
+	glm::dvec2 chunkWorldPosition = chunkToAbsoluteCoords(chunkPosition);
 
 	// Create the worm and set its starting point
 	glm::vec2 wormHeadNoisePosition;
 	wormHeadNoisePosition.x = SimplexNoise::noise(chunkWorldPosition.x / SMOOTHNESS);
 	wormHeadNoisePosition.y = SimplexNoise::noise(chunkWorldPosition.y / SMOOTHNESS);
-	
-	glm::vec2 wormHeadChunkPosition = chunkPosition;
 
 	// Set the worms max length
-	float wormNoiseMaxLength = SimplexNoise::noise(chunkPosition.x, chunkPosition.y);
+	float wormNoiseMaxLength = SimplexNoise::noise((double)chunkPosition.x, (double)chunkPosition.y);
 	size_t wormLength = (size_t)roundf(map(wormNoiseMaxLength, -1, 1, CAVE_WORM_LENGTH_MIN, CAVE_WORM_LENGTH_MAX));
 
 	// Chooses a random block within the chunk to start the worm
-	float wormStartX = SimplexNoise::noise(chunkWorldPosition.x + 0.1f / SMOOTHNESS, chunkWorldPosition.y + 0.1f / SMOOTHNESS, 0.16f);
-	float wormStartY = SimplexNoise::noise(chunkWorldPosition.x + 0.1f / SMOOTHNESS, chunkWorldPosition.y + 0.1f / SMOOTHNESS, 0.64f);
+	float wormStartX = SimplexNoise::noise(chunkWorldPosition.x + 0.1f / SMOOTHNESS, chunkWorldPosition.y + 0.1f / SMOOTHNESS, 0.16);
+	float wormStartY = SimplexNoise::noise(chunkWorldPosition.x + 0.1f / SMOOTHNESS, chunkWorldPosition.y + 0.1f / SMOOTHNESS, 0.64);
 
-	wormStartX = (float)(int)(map(wormStartX, -1, 1, chunkWorldPosition.x, chunkWorldPosition.x + CHUNK_SIZE * BLOCK_SIZE));
-	wormStartY = (float)(int)(map(wormStartY, -1, 1, chunkWorldPosition.y, chunkWorldPosition.y + CHUNK_SIZE * BLOCK_SIZE));
+	int wormStartBlockX = std::min((int)(map(wormStartX, -1, 1, 0, CHUNK_SIZE)), CHUNK_SIZE - 1);
+	int wormStartBlockY = std::min((int)(map(wormStartY, -1, 1, 0, CHUNK_SIZE)), CHUNK_SIZE - 1);
 
-	// Snaps starting world position to grid
-	glm::vec2 wormStartPosition = snapToBlockGrid(glm::vec2(wormStartX, wormStartY));
-	glm::vec2 wormCurrentPosition = wormStartPosition;
+	// The worm's position is kept in blocks from the world origin, so it stays exact however far out the chunk is
+	int64_t wormBlockX = chunkPosition.x * CHUNK_SIZE + wormStartBlockX;
+	int64_t wormBlockY = chunkPosition.y * CHUNK_SIZE + wormStartBlockY;
 
 	glm::vec2 currentNoisePosition = wormHeadNoisePosition;
 
@@ -514,25 +757,38 @@ std::vector<Chunk*> Terrain::genCaveWorm(glm::vec2 chunkPosition)
 	for (size_t i = 0; i < wormLength; i++)
 	{
 		// Gets the chunk that the current position is in (might be different)
-		glm::vec2 currentChunkPosition = worldToChunkCoords(wormCurrentPosition);
-		auto chunkIt = m_chunks.find(currentChunkPosition);
-		if (chunkIt == m_chunks.end())
+		ChunkCoords currentChunkPosition = ChunkCoords::fromBlock(wormBlockX, wormBlockY, CHUNK_SIZE);
+
+		Chunk* currentChunk = nullptr;
+		bool isNewChunk = false;
+		{
+			std::lock_guard<std::recursive_mutex> chunksLock(m_chunksMutex);
+
+			currentChunk = getChunk(currentChunkPosition);
+			if (!currentChunk)
+			{
+				currentChunk = createChunk(currentChunkPosition);
+				isNewChunk = true;
+			}
+		}
+
+		if (isNewChunk)
 		{			
 			// Need to wait and generate the chunk for the worm to continue through
-			chunk = createChunk(currentChunkPosition);
+			chunk = currentChunk;
 			modifiedChunks.push_back(chunk);
 
 			queueGenChunk(chunk);
 			
 			std::unique_lock<std::mutex> lock(chunk->mutex);
-			chunk->cv.wait(lock); // Waits for the chunk to be fully generated
+			chunk->cv.wait(lock, [chunk] { return chunk->hasGenerated; }); // Waits for the chunk to be fully generated
 		}
 		else
 		{
 			// Check if the chunk the worm is in has changed
-			if (chunk != chunkIt->second)
+			if (chunk != currentChunk)
 			{
-				chunk = chunkIt->second;
+				chunk = currentChunk;
 				if (std::find(modifiedChunks.begin(), modifiedChunks.end(), chunk) == modifiedChunks.end())
 				{
 					modifiedChunks.push_back(chunk);
@@ -540,44 +796,38 @@ std::vector<Chunk*> Terrain::genCaveWorm(glm::vec2 chunkPosition)
 			}
 
 			std::unique_lock<std::mutex> lock(chunk->mutex);
-			if (!chunk->hasGenerated) // Chunk exists, but hasn't fully generated yet
-			{
-				chunk->cv.wait(lock); // Waits for the chunk to be fully generated
-			}
+			chunk->cv.wait(lock, [chunk] { return chunk->hasGenerated; }); // Waits for the chunk to be fully generated
 		}
 
 		float wormWidthNoise = SimplexNoise::noise((float)i / wormLength / SMOOTHNESS, currentNoisePosition.y / SMOOTHNESS);
 		int wormRadius = (int)roundf(map(wormWidthNoise, -1, 1, CAVE_WORM_RADIUS_MIN, CAVE_WORM_RADIUS_MAX));
 
-		// Convert the current position to block coordinates
-		glm::vec2 currentChunkWorldPosition = chunkToWorldCoords(currentChunkPosition);
-		glm::vec2 blockWorldDelta = wormCurrentPosition - currentChunkWorldPosition;
-		glm::vec2 blockIndices = (glm::vec2((int)(blockWorldDelta.x / BLOCK_SIZE) % CHUNK_SIZE, (int)(blockWorldDelta.y / BLOCK_SIZE) % CHUNK_SIZE));
+		// Convert the current position to block coordinates within the chunk
+		int blockIndexX = (int)(wormBlockX - currentChunkPosition.x * CHUNK_SIZE);
+		int blockIndexY = (int)(wormBlockY - currentChunkPosition.y * CHUNK_SIZE);
 
 		{
 			// Take ownership of the chunk while carving out the worm
 			std::unique_lock<std::mutex> lock(chunk->mutex);
 
-			for (ptrdiff_t j = -wormRadius; j <= wormRadius; j++)
+			for (int j = -wormRadius; j <= wormRadius; j++)
 			{
-				for (ptrdiff_t k = -wormRadius; k <= wormRadius; k++)
+				for (int k = -wormRadius; k <= wormRadius; k++)
 				{
-					glm::vec2 currentBlockIndices = blockIndices + glm::vec2(k, j);
-					
 					// Check if these indices are within the worm radius
-					if ((currentBlockIndices.x - blockIndices.x) * (currentBlockIndices.x - blockIndices.x) +
-						(currentBlockIndices.y - blockIndices.y) * (currentBlockIndices.y - blockIndices.y) <= wormRadius * wormRadius)
-					{
-						// Skip this block if it's not within the chunk
-						if (currentBlockIndices.x < 0 || currentBlockIndices.x >= CHUNK_SIZE ||
-							currentBlockIndices.y < 0 || currentBlockIndices.y >= CHUNK_SIZE) continue;
+					if (k * k + j * j > wormRadius * wormRadius) continue;
 
-						Block& block = chunk->blocks[(int)currentBlockIndices.x + (int)currentBlockIndices.y * CHUNK_SIZE];
+					// Skip this block if it's not within the chunk
+					int currentBlockIndexX = blockIndexX + k;
+					int currentBlockIndexY = blockIndexY + j;
+					if (currentBlockIndexX < 0 || currentBlockIndexX >= CHUNK_SIZE ||
+						currentBlockIndexY < 0 || currentBlockIndexY >= CHUNK_SIZE) continue;
 
-						chunk->blockCount[block.blockType]--;
-						setBlock(block, AIR, block.transform.position, 0);
-						chunk->blockCount[AIR]++;
-					}
+					Block& block = chunk->blocks[currentBlockIndexX + currentBlockIndexY * CHUNK_SIZE];
+
+					chunk->blockCount[block.blockType]--;
+					setBlock(block, AIR, block.transform.position, 0);
+					chunk->blockCount[AIR]++;
 				}
 			}
 		}
@@ -587,25 +837,22 @@ std::vector<Chunk*> Terrain::genCaveWorm(glm::vec2 chunkPosition)
 		currentNoisePosition.y = wormHeadNoisePosition.y + (i * 0.64f);
 
 		float noiseValue = SimplexNoise::noise(currentNoisePosition.x, currentNoisePosition.y);
-		glm::vec2 nextPosition;
 		if (noiseValue <= -0.25f)
 		{
-			nextPosition = glm::vec2(0, -BLOCK_SIZE);
+			wormBlockY--;
 		}
 		else if (noiseValue > -0.25f && noiseValue <= 0.20f)
 		{
-			nextPosition = glm::vec2(BLOCK_SIZE, 0);
+			wormBlockX++;
 		}
 		else if (noiseValue > 0.20f && noiseValue <= 0.75f)
 		{
-			nextPosition = glm::vec2(-BLOCK_SIZE, 0);
+			wormBlockX--;
 		}
 		else
 		{
-			nextPosition = glm::vec2(0, BLOCK_SIZE);
+			wormBlockY++;
 		}
-
-		wormCurrentPosition += nextPosition;
 	}
 
 	return modifiedChunks;
@@ -613,7 +860,7 @@ std::vector<Chunk*> Terrain::genCaveWorm(glm::vec2 chunkPosition)
 
 void Terrain::genTrees(Chunk* baseChunk)
 {
-	glm::vec2 baseChunkWorldPosition = chunkToWorldCoords(baseChunk->chunkPosition);
+	glm::dvec2 baseChunkWorldPosition = chunkToAbsoluteCoords(baseChunk->chunkPosition);
 
 	for (int i = 0; i < CHUNK_SIZE; i++)
 	{
@@ -626,7 +873,7 @@ void Terrain::genTrees(Chunk* baseChunk)
 		if (surfaceHeight < baseChunkWorldPosition.y || surfaceHeight >= baseChunkWorldPosition.y + CHUNK_SIZE * BLOCK_SIZE)
 			continue;
 
-		glm::vec2 blockWorldPosition = glm::vec2(baseChunkWorldPosition.x + i * BLOCK_SIZE, surfaceHeight - 2 * BLOCK_SIZE);
+		glm::dvec2 blockWorldPosition = glm::dvec2(baseChunkWorldPosition.x + i * BLOCK_SIZE, surfaceHeight - 2 * BLOCK_SIZE);
 		glm::vec2 blockPosition = glm::vec2(i, surfaceHeight / BLOCK_SIZE - 2);
 
 		// Decide if we should place a tree here
@@ -810,14 +1057,6 @@ void Terrain::genTrees(Chunk* baseChunk)
 	//}
 }
 
-void Terrain::sortBlockIndexMap(const Block blocks[CHUNK_SIZE * CHUNK_SIZE], unsigned int blockIndexMap[CHUNK_SIZE * CHUNK_SIZE])
-{
-	std::sort(blockIndexMap, blockIndexMap + CHUNK_SIZE * CHUNK_SIZE, [&blocks](const unsigned int& index1, const unsigned int &index2)
-	{
-		return blocks[index1].blockType < blocks[index2].blockType;
-	});
-}
-
 void Terrain::checkThreadsFinished()
 {
 	// Remove any finished chunk gen threads
@@ -850,10 +1089,18 @@ void Terrain::checkThreadsFinished()
 
 				modifiedChunk.hasFullyLoaded = true;
 
-				// Resort the block index map since the chunks was modified
-				sortBlockIndexMap(modifiedChunk.blocks, modifiedChunk.blockIndexMap);
-				
-				// Update the drawing buffers with the newly sorted block indices
+#if TERRAIN_COLLISION
+				{
+					std::unique_lock<std::mutex> lock(modifiedChunk.mutex);
+					updateChunkCollision(modifiedChunk);
+				}
+#endif
+
+				// Chunks created outside of every observer's interest (e.g. by cave worms) can be unloaded now that they're done
+				if (m_chunkTickets.count(modifiedChunk.chunkPosition) == 0)
+					m_unloadCandidates.insert(modifiedChunk.chunkPosition);
+
+				// Update the drawing buffers with the modified blocks
 				if (modifiedChunk.containerIndex > -1)
 					m_terrainRenderer->updateDrawingBuffers(modifiedChunk.containerIndex);
 			}
@@ -865,65 +1112,167 @@ void Terrain::checkThreadsFinished()
 	}
 }
 
-void Terrain::checkGenChunks(const Camera& camera)
+void Terrain::refreshObserver(ChunkObserver& observer, bool forceGen)
 {
-	std::vector<Chunk*> chunks;
+	float chunkWorldSize = CHUNK_SIZE * BLOCK_SIZE;
+	ChunkCoords observerChunkPosition = worldToChunkCoords(observer.position);
+
+	// Extend the gen buffer along the direction of travel and shrink it behind
+	ChunkBuffer genBuffer = calculateChunkBuffer(observer.genRadius, PREFETCH_MIN_BEHIND_CHUNKS, observer.velocity);
+	ChunkRect genRect(observerChunkPosition.x - genBuffer.left, observerChunkPosition.y - genBuffer.bottom,
+		observerChunkPosition.x + genBuffer.right, observerChunkPosition.y + genBuffer.top);
+
+	// The unload buffer is extended by the same amount as the gen buffer ahead, so prefetched chunks aren't unloaded right away
+	ChunkBuffer unloadBuffer = calculateChunkBuffer(observer.unloadRadius, PREFETCH_MIN_BEHIND_CHUNKS + (observer.unloadRadius - observer.genRadius), observer.velocity);
+	ChunkCoords ticketMin = worldToChunkCoords(observer.position - observer.viewSize * 0.5f - glm::vec2(unloadBuffer.left, unloadBuffer.bottom) * chunkWorldSize);
+	ChunkCoords ticketMax = worldToChunkCoords(observer.position + observer.viewSize * 0.5f + glm::vec2(unloadBuffer.right, unloadBuffer.top) * chunkWorldSize);
+	ChunkRect ticketRect(ticketMin.x, ticketMin.y, ticketMax.x, ticketMax.y);
+
+	// Only touch the tickets and the chunk map when the observer has moved into a different set of chunks
+	if (ticketRect != observer.ticketRect)
+	{
+		moveTickets(observer.ticketRect, ticketRect);
+		observer.ticketRect = ticketRect;
+	}
 
-	glm::vec2 cameraPosition = camera.getPosition();
-	int cameraWidth = camera.getWidth();
-	int cameraHeight = camera.getHeight();
+	if (forceGen || genRect != observer.genRect)
+	{
+		genChunksInRect(genRect, observerChunkPosition);
+		observer.genRect = genRect;
+	}
+}
 
-	glm::vec2 cameraChunkPosition = worldToChunkCoords(cameraPosition);
+void Terrain::genChunksInRect(const ChunkRect& rect, ChunkCoords centerChunkPosition)
+{
+	std::vector<Chunk*> chunks;
 
-	// Check for chunks in a square around the camera
-	for (ptrdiff_t j = (ptrdiff_t)cameraChunkPosition.y - CAMERA_VIEW_BUFFER_GEN; j <= cameraChunkPosition.y + CAMERA_VIEW_BUFFER_GEN; j++)
 	{
-		for (ptrdiff_t i = (ptrdiff_t)cameraChunkPosition.x - CAMERA_VIEW_BUFFER_GEN; i <= cameraChunkPosition.x + CAMERA_VIEW_BUFFER_GEN; i++)
+		std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
+
+		for (int64_t j = rect.bottom; j <= rect.top; j++)
 		{
-			glm::vec2 chunkPosition = glm::vec2(i, j);
-			if (m_chunks.count(chunkPosition) == 0)
+			for (int64_t i = rect.left; i <= rect.right; i++)
 			{
-				Chunk* chunk = createChunk(chunkPosition);
-				chunks.push_back(chunk);
+				ChunkCoords chunkPosition = ChunkCoords(i, j);
+				if (m_chunks.count(chunkPosition) == 0)
+				{
+					Chunk* chunk = createChunk(chunkPosition);
+					chunks.push_back(chunk);
+				}
 			}
 		}
 	}
 
 	if (!chunks.empty())
+	{
+		// Queue the chunks closest to the observer first, so the visible ones aren't stuck behind the prefetched ones
+		std::sort(chunks.begin(), chunks.end(), [&centerChunkPosition](const Chunk* chunk1, const Chunk* chunk2)
+		{
+			ChunkCoords delta1 = chunk1->chunkPosition - centerChunkPosition;
+			ChunkCoords delta2 = chunk2->chunkPosition - centerChunkPosition;
+			return delta1.x * delta1.x + delta1.y * delta1.y < delta2.x * delta2.x + delta2.y * delta2.y;
+		});
+
 		queueGenChunks(chunks);
+	}
 }
 
-void Terrain::checkUnloadChunks(const Camera& camera)
+void Terrain::moveTickets(const ChunkRect& oldRect, const ChunkRect& newRect)
 {
-	glm::vec2 cameraPosition = camera.getPosition();
-	int cameraWidth = camera.getWidth();
-	int cameraHeight = camera.getHeight();
-
-	std::vector<glm::vec2> chunksToUnload;
-	for (auto it = m_chunks.begin(); it != m_chunks.end(); it++)
+	// Release the tickets on the chunks that are no longer in the rect
+	for (int64_t j = oldRect.bottom; j <= oldRect.top; j++)
 	{
-		// Don't unload chunks that haven't been fully loaded yet, as that can cause multithreaded crashes
-		if (!it->second || !it->second->hasFullyLoaded) continue;
+		for (int64_t i = oldRect.left; i <= oldRect.right; i++)
+		{
+			if (newRect.contains(i, j)) continue;
 
-		glm::vec2 chunkWorldPosition = chunkToWorldCoords(it->first);
-		float worldUnloadBuffer = CAMERA_VIEW_BUFFER_UNLOAD * CHUNK_SIZE * BLOCK_SIZE;
-		if (chunkWorldPosition.x + CHUNK_SIZE * BLOCK_SIZE < cameraPosition.x - cameraWidth * 0.5f - worldUnloadBuffer ||
-			chunkWorldPosition.x > cameraPosition.x + cameraWidth * 0.5f + worldUnloadBuffer ||
-			chunkWorldPosition.y + CHUNK_SIZE * BLOCK_SIZE < cameraPosition.y - cameraHeight * 0.5f - worldUnloadBuffer ||
-			chunkWorldPosition.y > cameraPosition.y + cameraHeight * 0.5f + worldUnloadBuffer)
+			ChunkCoords chunkPosition = ChunkCoords(i, j);
+			auto it = m_chunkTickets.find(chunkPosition);
+			if (it == m_chunkTickets.end()) continue;
+
+			if (--it->second == 0)
+			{
+				m_chunkTickets.erase(it);
+				m_unloadCandidates.insert(chunkPosition);
+			}
+		}
+	}
+
+	// Take a ticket on the chunks that are new to the rect
+	for (int64_t j = newRect.bottom; j <= newRect.top; j++)
+	{
+		for (int64_t i = newRect.left; i <= newRect.right; i++)
 		{
-			delete it->second;
-			it->second = nullptr;
-			chunksToUnload.push_back(it->first);
+			if (oldRect.contains(i, j)) continue;
+
+			m_chunkTickets[ChunkCoords(i, j)]++;
 		}
 	}
+}
+
+void Terrain::checkUnloadChunks()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_chunksMutex);
 
-	for (size_t i = 0; i < chunksToUnload.size(); i++)
+	for (auto it = m_unloadCandidates.begin(); it != m_unloadCandidates.end();)
 	{
-		m_chunks.erase(chunksToUnload[i]);
+		// An observer has taken a ticket on the chunk again
+		if (m_chunkTickets.count(*it) > 0)
+		{
+			it = m_unloadCandidates.erase(it);
+			continue;
+		}
+
+		auto chunkIt = m_chunks.find(*it);
+		if (chunkIt == m_chunks.end())
+		{
+			it = m_unloadCandidates.erase(it);
+			continue;
+		}
+
+		// Don't unload chunks that haven't been fully loaded yet, as that can cause multithreaded crashes.
+		// They'll be checked again next frame.
+		Chunk* chunk = chunkIt->second;
+		if (!chunk->hasFullyLoaded)
+		{
+			it++;
+			continue;
+		}
+
+		// Free the chunk's container for another chunk
+		if (chunk->containerIndex > -1)
+			m_terrainRenderer->releaseContainer(chunk->containerIndex);
+
+		destroyChunk(chunk);
+		m_chunks.erase(chunkIt);
+		it = m_unloadCandidates.erase(it);
 	}
 }
 
+ChunkBuffer Terrain::calculateChunkBuffer(int baseBuffer, int minBehind, glm::vec2 velocity) const
+{
+	// Axes moving slower than the dead zone get the symmetric base buffer
+	if (fabsf(velocity.x) < PREFETCH_MIN_SPEED) velocity.x = 0.0f;
+	if (fabsf(velocity.y) < PREFETCH_MIN_SPEED) velocity.y = 0.0f;
+
+	// How many chunks will be travelled through in the lookahead time
+	float chunkWorldSize = CHUNK_SIZE * BLOCK_SIZE;
+	int lookaheadX = (int)ceilf(fminf(fabsf(velocity.x) * PREFETCH_LOOKAHEAD_TIME / chunkWorldSize, PREFETCH_MAX_EXTRA_CHUNKS));
+	int lookaheadY = (int)ceilf(fminf(fabsf(velocity.y) * PREFETCH_LOOKAHEAD_TIME / chunkWorldSize, PREFETCH_MAX_EXTRA_CHUNKS));
+
+	// The buffer behind shrinks by the same amount, but never below the minimum
+	int shrinkX = std::max(0, std::min(lookaheadX, baseBuffer - minBehind));
+	int shrinkY = std::max(0, std::min(lookaheadY, baseBuffer - minBehind));
+
+	ChunkBuffer buffer;
+	buffer.left = velocity.x < 0 ? baseBuffer + lookaheadX : baseBuffer - shrinkX;
+	buffer.right = velocity.x > 0 ? baseBuffer + lookaheadX : baseBuffer - shrinkX;
+	buffer.bottom = velocity.y < 0 ? baseBuffer + lookaheadY : baseBuffer - shrinkY;
+	buffer.top = velocity.y > 0 ? baseBuffer + lookaheadY : baseBuffer - shrinkY;
+
+	return buffer;
+}
+
 void Terrain::setBlock(Block& block, BlockType type, glm::vec2 position, unsigned int uvOffsetIndex)
 {
 	block.transform.position = position;
@@ -935,26 +1284,28 @@ void Terrain::setBlock(Block& block, BlockType type, glm::vec2 position, unsigne
 	block.renderable.uvOffsetIndex = uvOffsetIndex;
 }
 
-int Terrain::calculateSurfaceHeight(float chunkWorldPositionX, size_t blockX)
+int Terrain::calculateSurfaceHeight(double chunkAbsolutePositionX, size_t blockX)
 {
-	return (int)(roundf(m_terrainNoise->fractal(SURFACE_OCTAVES, (chunkWorldPositionX + blockX * BLOCK_SIZE + 1) / TERRAIN_SMOOTHESS) * HEIGHT_FLUX / BLOCK_SIZE) * BLOCK_SIZE);
+	return (int)(roundf(m_terrainNoise->fractal(SURFACE_OCTAVES, (chunkAbsolutePositionX + blockX * BLOCK_SIZE + 1) / TERRAIN_SMOOTHESS) * HEIGHT_FLUX / BLOCK_SIZE) * BLOCK_SIZE);
 }
 
-glm::vec2 Terrain::worldToChunkCoords(glm::vec2 worldPosition)
+ChunkCoords Terrain::worldToChunkCoords(glm::vec2 worldPosition) const
 {
 	float roundFactor = CHUNK_SIZE * BLOCK_SIZE;
-	float x = (floorf(worldPosition.x / roundFactor));
-	float y = (floorf(worldPosition.y / roundFactor));
+	int64_t x = (int64_t)floorf(worldPosition.x / roundFactor);
+	int64_t y = (int64_t)floorf(worldPosition.y / roundFactor);
 
-	return glm::vec2(x, y);
+	return m_originChunk + ChunkCoords(x, y);
 }
 
-glm::vec2 Terrain::chunkToWorldCoords(glm::vec2 chunkPosition)
+glm::vec2 Terrain::chunkToWorldCoords(ChunkCoords chunkPosition) const
 {
-	return chunkPosition * (float)(CHUNK_SIZE * BLOCK_SIZE);
+	// Only the offset from the origin is converted to floats, so this stays precise near the origin wherever it is
+	ChunkCoords chunkOffset = chunkPosition - m_originChunk;
+	return glm::vec2((float)chunkOffset.x, (float)chunkOffset.y) * (float)(CHUNK_SIZE * BLOCK_SIZE);
 }
 
-glm::vec2 Terrain::snapToBlockGrid(glm::vec2 worldPosition)
+glm::dvec2 Terrain::chunkToAbsoluteCoords(ChunkCoords chunkPosition)
 {
-	return glm::vec2((int)(worldPosition.x / BLOCK_SIZE) * BLOCK_SIZE, (int)(worldPosition.y / BLOCK_SIZE) * BLOCK_SIZE);
+	return glm::dvec2((double)chunkPosition.x, (double)chunkPosition.y) * (double)(CHUNK_SIZE * BLOCK_SIZE);
 }
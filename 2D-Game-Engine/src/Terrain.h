@@ -7,14 +7,13 @@
 
 #include <future>
 #include <mutex>
+#include <unordered_set>
 
 #define map(input, inputMin, inputMax, outputMin, outputMax) outputMin + ((outputMax - outputMin) / (inputMax - inputMin)) * (input - inputMin)
 
 #define SMOOTHNESS 400.0f // A smoothness value used for smoothing out noise (higher is smoother)
 #define TERRAIN_SMOOTHESS 800.0f  // A smoothness value used for smoothing out terrain noise (higher is smoother)
 
-#define CHUNK_SIZE 64 // The width (and height) of a chunk in blocks
-
 #define HEIGHT_FLUX 1536 // The height fluctuation of the surface in pixels
 #define SURFACE_OCTAVES 4 // The number of octaves used in the noise function for calculating terrain height (how many noise samples are blended together)
 
@@ -25,6 +24,15 @@
 #define CAMERA_VIEW_BUFFER_GEN 4 // Number of chunks to add to the camera's chunk when checking for chunk generation
 #define CAMERA_VIEW_BUFFER_UNLOAD 8 // Number of chunks to add to the camera's edge when checking for chunks to unload
 
+#define PREFETCH_LOOKAHEAD_TIME 2.0f // How many seconds of travel the gen and unload buffers are extended by in the direction of travel
+#define PREFETCH_MAX_EXTRA_CHUNKS 6 // The maximum number of chunks the buffers can be extended by in the direction of travel
+#define PREFETCH_MIN_BEHIND_CHUNKS 2 // The minimum number of chunks the gen buffer keeps behind the direction of travel
+#define PREFETCH_MIN_SPEED 32.0f // Speeds below this in pixels per second don't extend the buffers, so jitter while standing still doesn't flip them between sides
+
+#define TERRAIN_COLLISION 0 // Whether chunks get physics fixtures for their solid blocks (1) or the terrain can be passed through (0)
+
+#define WARM_UP_GEN_BUFFER 0 // Whether the startup warm-up should also generate the whole gen buffer around the camera (1) or only the visible chunks (0)
+
 #define TERRAIN_CHUNK_HEIGHT 16 // The number of vertical chunks in the terrain
 
 #define CAVE_WORM_LENGTH_MIN 512 // The minimum number of worm segments used for cave generation
@@ -43,6 +51,8 @@
 #define TREE_BRANCH_HEIGHT_MIN 4 // The minimum number of blocks above the base of the tree that branches will start to generate
 #define TREE_BRANCH_HEIGHT_MAX 10 // The maximum number of blocks above the base of the tree that branches will start to generate
 
+#define BLOCK_DEBRIS_COUNT 8 // The number of particles a block breaks into when it's dug out
+
 enum ChunkType
 {
 	CHUNK_AIR,
@@ -50,12 +60,38 @@ enum ChunkType
 	CHUNK_UNDERGROUND
 };
 
-struct Chunk
+// The number of chunks a buffer extends from the camera in each direction
+struct ChunkBuffer
+{
+	int left;
+	int right;
+	int bottom;
+	int top;
+};
+
+// Anything that wants the terrain around it to stay loaded (a player, a simulated entity, a scripted region...)
+struct ChunkObserver
+{
+	glm::vec2 position; // Relative to the terrain's origin chunk, like every other world position
+	glm::vec2 viewSize;
+	glm::vec2 velocity;
+
+	int genRadius; // Number of chunks around the observer's chunk that are generated
+	int unloadRadius; // Number of chunks around the observer's view that are kept loaded
+
+	ChunkRect genRect;
+	ChunkRect ticketRect; // The chunks this observer currently holds a ticket on
+};
+
+template<int Size>
+struct BasicChunk
 {
-	Chunk(glm::vec2 chunkPosition) : chunkPosition(chunkPosition), physicsObject(PhysicsObject(0)) {}
+	typedef ChunkLayout<Size> Layout;
 
-	Block blocks[CHUNK_SIZE * CHUNK_SIZE];
-	unsigned int blockIndexMap[CHUNK_SIZE * CHUNK_SIZE];
+	BasicChunk(ChunkCoords chunkPosition) : chunkPosition(chunkPosition), physicsObject(PhysicsObject(0)) {}
+
+	Block blocks[Layout::blockCount];
+	TerrainInstance instances[Layout::instanceCount]; // The blocks' GPU instance data at every detail level, built by whoever last changed them
 	unsigned int blockCount[BLOCK_COUNT];
 
 	std::mutex mutex;
@@ -63,7 +99,7 @@ struct Chunk
 	
 	PhysicsObject physicsObject;
 
-	const glm::vec2 chunkPosition;
+	const ChunkCoords chunkPosition;
 	ChunkType chunkType;
 	int containerIndex;
 	bool hasWormHead;
@@ -74,24 +110,41 @@ struct Chunk
 class Terrain
 {
 public:
-	Terrain(b2World& physicsWorld, glm::vec2 startingPosition, unsigned int vertexBufferID, unsigned int indexBufferID);
+	Terrain(b2World& physicsWorld, const Camera& camera, unsigned int indexBufferID);
 	~Terrain();
 
-	Chunk* createChunk(glm::vec2 chunkPosition);
-	Chunk* getChunk(glm::vec2 chunkPosition) const;
+	Chunk* createChunk(ChunkCoords chunkPosition);
+	Chunk* getChunk(ChunkCoords chunkPosition) const;
+
+	bool editBlock(glm::vec2 worldPosition, BlockType type);
+
+	size_t addObserver(glm::vec2 position, glm::vec2 viewSize, int genRadius = CAMERA_VIEW_BUFFER_GEN, int unloadRadius = CAMERA_VIEW_BUFFER_UNLOAD);
+	void updateObserver(size_t observerID, glm::vec2 position, glm::vec2 viewSize, glm::vec2 velocity);
+	void removeObserver(size_t observerID);
 
 	void cameraUpdate(const Camera& camera);
-	void update();
+	void update(float deltaTime);
+
+	void render(const Camera& camera);
 
-	void render(const Camera& camera) const;
+	const CullStats& getLastFrameCullStats() const;
 
-	static glm::vec2 worldToChunkCoords(glm::vec2 worldPosition);
-	static glm::vec2 chunkToWorldCoords(glm::vec2 chunkPosition);
-	static glm::vec2 snapToBlockGrid(glm::vec2 worldPosition);
+	// For profiling the chunk streaming
+	size_t getResidentChunkCount() const;
+	size_t getQueuedGenChunkCount() const;
+	size_t getGenThreadCount() const; // Gen and post gen threads that haven't been collected yet
+
+	void shiftOrigin(ChunkCoords chunkDelta);
+	ChunkCoords getOriginChunk() const;
+
+	ChunkCoords worldToChunkCoords(glm::vec2 worldPosition) const;
+	glm::vec2 chunkToWorldCoords(ChunkCoords chunkPosition) const;
+	static glm::dvec2 chunkToAbsoluteCoords(ChunkCoords chunkPosition);
 
 private:
-	void genStartingChunks(glm::vec2 startingPosition);
-	void genChunks();
+	void genStartingChunks(const Camera& camera);
+	void warmUpChunks(const std::vector<Chunk*>& chunks);
+	void genChunks(size_t maxChunks = 1);
 	void queueGenChunk(Chunk* chunk);
 	void queueGenChunks(const std::vector<Chunk*>& chunks);
 
@@ -99,22 +152,32 @@ private:
 	std::vector<Chunk*> postGenChunkThreaded(Chunk* chunk);
 
 	void unloadChunks();
+	void destroyChunk(Chunk* chunk);
 
-	void updateGrassBlocks(glm::vec2 chunkWorldPosition, Block* blocks);
+	void updateGrassBlocks(Block* blocks);
 
-	void genCave(Block* blocks, unsigned int blockCount[BLOCK_COUNT], glm::vec2 chunkWorldPosition);
-	std::vector<Chunk*> genCaveWorm(glm::vec2 chunkPosition);
-	void genTrees(Chunk* baseChunk);
+	void spawnBlockDebris(BlockType type, glm::vec2 worldPosition);
 
-	void sortBlockIndexMap(const Block blocks[CHUNK_SIZE * CHUNK_SIZE], unsigned int blockIndexMap[CHUNK_SIZE * CHUNK_SIZE]);
+	// Rebuilds the chunk's physics fixtures from its blocks, one box per horizontal run of solid blocks, creating its body the first time.
+	// The chunk's mutex has to be held, and this has to be called from the simulation, since Box2D isn't thread safe.
+	void updateChunkCollision(Chunk& chunk);
+	static bool isSolidBlock(BlockType type);
+
+	void genCave(Block* blocks, unsigned int blockCount[BLOCK_COUNT], glm::dvec2 chunkAbsolutePosition);
+	std::vector<Chunk*> genCaveWorm(ChunkCoords chunkPosition);
+	void genTrees(Chunk* baseChunk);
 
 	void checkThreadsFinished();
-	void checkGenChunks(const Camera& camera);
-	void checkUnloadChunks(const Camera& camera);
+	void refreshObserver(ChunkObserver& observer, bool forceGen);
+	void genChunksInRect(const ChunkRect& rect, ChunkCoords centerChunkPosition);
+	void moveTickets(const ChunkRect& oldRect, const ChunkRect& newRect);
+	void checkUnloadChunks();
+
+	ChunkBuffer calculateChunkBuffer(int baseBuffer, int minBehind, glm::vec2 velocity) const;
 
 	void setBlock(Block& block, BlockType type, glm::vec2 position, unsigned int uvOffsetIndex);
 	
-	int calculateSurfaceHeight(float chunkWorldPositionX, size_t blockX);
+	int calculateSurfaceHeight(double chunkAbsolutePositionX, size_t blockX);
 
 	TerrainRenderer* m_terrainRenderer;
 
@@ -123,10 +186,19 @@ private:
 	SimplexNoise* m_terrainNoise;
 	SimplexNoise* m_treeNoise;
 
-	std::unordered_map<glm::vec2, Chunk*> m_chunks;
+	std::unordered_map<ChunkCoords, Chunk*> m_chunks;
+	mutable std::recursive_mutex m_chunksMutex;
+
+	ChunkCoords m_originChunk; // The chunk that sits at world position (0, 0), moved by the floating origin
+
+	std::unordered_map<size_t, ChunkObserver> m_observers;
+	size_t m_nextObserverID;
+
+	std::unordered_map<ChunkCoords, unsigned int> m_chunkTickets; // The number of observers interested in each chunk position
+	std::unordered_set<ChunkCoords> m_unloadCandidates; // Chunk positions that have lost all of their tickets
 
 	std::vector<Chunk*> m_queuedChunksToGen;
-	std::mutex m_genQueueMutex;
+	mutable std::mutex m_genQueueMutex;
 
 	std::vector<std::future<Chunk*>> m_genChunkThreads;
 	std::vector<std::future<std::vector<Chunk*>>> m_postGenThreads;
@@ -1,128 +1,78 @@
 #include "stdafx.h"
 #include "TerrainRenderer.h"
 
+#include "GraphicsDevice.h"
 #include "Terrain.h"
-
-#include <GL/glew.h>
+#include "UploadRingBuffer.h"
 
 #ifdef _DEBUG
 #include "Input.h"
 #endif
 
-TerrainRenderer::TerrainRenderer(Terrain* terrain, unsigned int vertexBufferID, unsigned int indexBufferID)
-	: m_terrain(terrain), m_vertexBufferID(vertexBufferID), m_indexBufferID(indexBufferID)
+TerrainRenderer::TerrainRenderer(Terrain* terrain, unsigned int indexBufferID)
+	: m_terrain(terrain), m_indexBufferID(indexBufferID), m_vao(0), m_instanceBuffer(0), m_materialBuffer(0), m_indirectBuffer(0), m_chunkOriginBuffer(0), m_frame(0), m_animationTime(0.0)
 {
-}
-
-TerrainRenderer::~TerrainRenderer()
-{
-	for (size_t i = 0; i < CHUNK_CONTAINER_SIZE; i++)
-	{
-		glDeleteBuffers(1, &m_chunkContainers[i].worldPositionsVBO);
-		glDeleteBuffers(1, &m_chunkContainers[i].uvOffsetIndicesVBO);
-		glDeleteVertexArrays(1, &m_chunkContainers[i].vao);
-	}
-}
-
-void TerrainRenderer::initChunkContainers(std::vector<Chunk*> chunks, glm::vec2 startingChunkPosition)
-{
-	memset(m_chunkContainers, 0, sizeof(ChunkContainer) * CHUNK_CONTAINER_SIZE);
-
-	glm::vec2 worldPositions[CHUNK_SIZE * CHUNK_SIZE] = {};
-	unsigned int uvOffsetIndices[CHUNK_SIZE * CHUNK_SIZE] = {};
-
-	// Initialize rendering data
-	for (unsigned int i = 0; i < CHUNK_CONTAINER_SIZE; i++)
-	{
-		// VAO
-		glGenVertexArrays(1, &m_chunkContainers[i].vao);
-		glBindVertexArray(m_chunkContainers[i].vao);
+	m_uploadBuffer = new UploadRingBuffer();
 
-		// Vertices and indices
-		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
-
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	AssetManager* assetManager = AssetManager::getInstance();
+	m_shaderHandle = assetManager->getShaderHandle(ASSET_ID("terrainShader"));
+	m_textureHandle = assetManager->getTextureHandle(ASSET_ID("blockSpritesheet"));
 
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(float) * 2));
+	GraphicsDevice* device = GraphicsDevice::getInstance();
 
-		// World positions
-		glGenBuffers(1, &m_chunkContainers[i].worldPositionsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_chunkContainers[i].worldPositionsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * CHUNK_SIZE * CHUNK_SIZE, &worldPositions[0][0], GL_DYNAMIC_DRAW);
+	// Initialize rendering data. A single VAO and instance buffer are shared by every chunk container.
+	// The quad's corners are generated from gl_VertexID in the shader, so only the index buffer is needed.
+	// The instance buffer is created once the camera's view size is known.
+	m_vao = device->createVertexArray();
+	device->bindVertexArray(m_vao);
 
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
-		glVertexAttribDivisor(2, 1);
+	device->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
 
-		// UV offset indices
-		glGenBuffers(1, &m_chunkContainers[i].uvOffsetIndicesVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_chunkContainers[i].uvOffsetIndicesVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * CHUNK_SIZE * CHUNK_SIZE, &uvOffsetIndices[0], GL_DYNAMIC_DRAW);
+	m_instanceBuffer = device->createBuffer();
+	m_indirectBuffer = device->createBuffer();
+	m_chunkOriginBuffer = device->createBuffer();
 
-		glEnableVertexAttribArray(3);
-		glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
-		glVertexAttribDivisor(3, 1);
+	device->bindVertexArray(0);
 
-		m_chunkContainers[i].chunk = chunks[i];
-	}
+	uploadMaterialTable();
+}
 
-	// Calculates the bottom left origin of the chunk containers
-	m_chunkContainerOriginWorldPos = startingChunkPosition - glm::vec2(CHUNK_CONTAINER_DISTANCE / 2.0f);
-	m_chunkContainerOriginWorldPos = Terrain::chunkToWorldCoords(m_chunkContainerOriginWorldPos);
+TerrainRenderer::~TerrainRenderer()
+{
+	delete m_uploadBuffer;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->deleteBuffer(m_instanceBuffer);
+	device->deleteBuffer(m_materialBuffer);
+	device->deleteBuffer(m_indirectBuffer);
+	device->deleteBuffer(m_chunkOriginBuffer);
+	device->deleteVertexArray(m_vao);
 }
 
-std::vector<Chunk*> TerrainRenderer::checkShiftChunkContainers(const Camera& camera)
+std::vector<Chunk*> TerrainRenderer::updateChunkContainers(const Camera& camera)
 {
-	glm::vec2 cameraPosition = camera.getPosition();
-	int cameraWidth = camera.getWidth();
-	int cameraHeight = camera.getHeight();
+	m_frame++;
 
 	// List of chunks that need to be generated
 	std::vector<Chunk*> chunks;
 
-	// Check if we need to update the chunk containers from the right
-	if (cameraPosition.x + cameraWidth * 0.5f + CAMERA_VIEW_BUFFER_CONTAINER_REASSIGN >= m_chunkContainerOriginWorldPos.x + CHUNK_SIZE * BLOCK_SIZE * (CHUNK_CONTAINER_DISTANCE + 1))
-	{
-		// Converts the chunk containers' origin to chunk coordinates
-		glm::vec2 chunkContainerOriginPos = Terrain::worldToChunkCoords(m_chunkContainerOriginWorldPos);
-
-		// Unassign the leftmost chunks from the chunk containers
-		for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			ChunkContainer& chunkContainer = m_chunkContainers[i * (CHUNK_CONTAINER_DISTANCE + 1)];
-			chunkContainer.chunk->containerIndex = -1;
-			chunkContainer.chunk = nullptr;
+	// Grow the pool as soon as the view needs more containers, but only shrink it once it's far too big,
+	// so zooming doesn't throw away the uploaded chunks every frame
+	size_t requiredCount = calculateRequiredContainerCount(camera);
+	size_t containerCount = requiredCount + (size_t)ceilf(requiredCount * CHUNK_CONTAINER_POOL_SLACK);
+	if (m_chunkContainers.size() < requiredCount || m_chunkContainers.size() > containerCount * 2)
+		resizeContainerPool(containerCount);
 
-			clearWorldPositions(chunkContainer);
-			clearUVOffsetIndices(chunkContainer);
-		}
+	m_visibleRect = getViewChunkRect(camera, 0);
 
-		// Reassign the existing chunk containers
-		size_t chunkContainerIndex = 0;
-		for (size_t j = 0; j < CHUNK_CONTAINER_DISTANCE + 1; j++)
+	// Every chunk in and around the view needs a container. Chunks that already have one keep it.
+	ChunkRect residentRect = getViewChunkRect(camera, CHUNK_CONTAINER_PREFETCH);
+	for (int64_t y = residentRect.bottom; y <= residentRect.top; y++)
+	{
+		for (int64_t x = residentRect.left; x <= residentRect.right; x++)
 		{
-			chunkContainerIndex++;
+			ChunkCoords chunkPosition(x, y);
 
-			for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE; i++)
-			{
-				ChunkContainer& chunkContainer = m_chunkContainers[chunkContainerIndex];
-				chunkContainer.chunk->containerIndex -= 1;
-				m_chunkContainers[chunkContainerIndex - 1].chunk = chunkContainer.chunk;
-
-				if (chunkContainer.chunk->hasFullyLoaded)
-					updateDrawingBuffers(chunkContainerIndex - 1);
-
-				chunkContainerIndex++;
-			}
-		}
-
-		// Assign the rightmost containers, or generate them if necessary
-		for (int i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			glm::vec2 chunkPosition = glm::vec2(chunkContainerOriginPos.x + (CHUNK_CONTAINER_DISTANCE + 1), chunkContainerOriginPos.y + i);
 			Chunk* chunk = m_terrain->getChunk(chunkPosition);
 			if (!chunk)
 			{
@@ -130,313 +80,442 @@ std::vector<Chunk*> TerrainRenderer::checkShiftChunkContainers(const Camera& cam
 				chunks.push_back(chunk);
 			}
 
-			chunk->containerIndex = CHUNK_CONTAINER_DISTANCE + (CHUNK_CONTAINER_DISTANCE + 1) * i;
+			if (chunk->containerIndex > -1)
+			{
+				m_chunkContainers[chunk->containerIndex].lastUsedFrame = m_frame;
+				continue;
+			}
 
-			ChunkContainer& chunkContainer = m_chunkContainers[chunk->containerIndex];
-			chunkContainer.chunk = chunk;
+			int containerIndex = findFreeContainer();
+			if (containerIndex < 0)
+			{
+				Output::error("ERROR: Ran out of chunk containers for chunk X: " + std::to_string(x) + ", Y: " + std::to_string(y));
+				continue;
+			}
 
-			if (chunk->hasFullyLoaded)
-				updateDrawingBuffers(chunk->containerIndex);
+			assignContainer(containerIndex, chunk);
 		}
-
-		// Shift the chunk container origin by 1 chunk
-		m_chunkContainerOriginWorldPos.x += CHUNK_SIZE * BLOCK_SIZE;
 	}
 
-	// Check if we need to update the chunk containers from the left
-	if (cameraPosition.x - cameraWidth * 0.5f - CAMERA_VIEW_BUFFER_CONTAINER_REASSIGN <= m_chunkContainerOriginWorldPos.x)
-	{
-		// Converts the chunk containers' origin to chunk coordinates
-		glm::vec2 chunkContainerOriginPos = Terrain::worldToChunkCoords(m_chunkContainerOriginWorldPos);
+	return chunks;
+}
 
-		// Unassign the rightmost chunks from the chunk containers
-		for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			ChunkContainer& chunkContainer = m_chunkContainers[CHUNK_CONTAINER_DISTANCE + (CHUNK_CONTAINER_DISTANCE + 1) * i];
-			chunkContainer.chunk->containerIndex = -1;
-			chunkContainer.chunk = nullptr;
+void TerrainRenderer::releaseContainer(int containerIndex)
+{
+	ChunkContainer& chunkContainer = m_chunkContainers[containerIndex];
+	if (chunkContainer.chunk)
+		chunkContainer.chunk->containerIndex = -1;
 
-			clearWorldPositions(chunkContainer);
-			clearUVOffsetIndices(chunkContainer);
-		}
+	chunkContainer.chunk = nullptr;
+	chunkContainer.lastUsedFrame = 0;
+	chunkContainer.hasInstances = false;
+}
 
-		// Reassign the existing chunk containers
-		size_t chunkContainerIndex = CHUNK_CONTAINER_SIZE - 1;
-		for (size_t j = 0; j < CHUNK_CONTAINER_DISTANCE + 1; j++)
-		{
-			chunkContainerIndex--;
+void TerrainRenderer::releaseContainers()
+{
+	for (size_t i = 0; i < m_chunkContainers.size(); i++)
+	{
+		releaseContainer((int)i);
+	}
+}
 
-			for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE; i++)
-			{
-				ChunkContainer& chunkContainer = m_chunkContainers[chunkContainerIndex];
-				chunkContainer.chunk->containerIndex += 1;
-				m_chunkContainers[chunkContainerIndex + 1].chunk = chunkContainer.chunk;
+ChunkRect TerrainRenderer::getViewChunkRect(const Camera& camera, int buffer) const
+{
+	glm::vec2 halfViewSize = camera.getViewSize() * 0.5f;
+	ChunkCoords bottomLeft = m_terrain->worldToChunkCoords(camera.getViewPosition() - halfViewSize);
+	ChunkCoords topRight = m_terrain->worldToChunkCoords(camera.getViewPosition() + halfViewSize);
 
-				if (chunkContainer.chunk->hasFullyLoaded)
-					updateDrawingBuffers(chunkContainerIndex + 1);
+	return ChunkRect(bottomLeft.x - buffer, bottomLeft.y - buffer, topRight.x + buffer, topRight.y + buffer);
+}
 
-				chunkContainerIndex--;
-			}
+void TerrainRenderer::update(const Camera& camera)
+{
+#ifdef _DEBUG
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_F))
+	{
+		for (size_t i = 0; i < m_chunkContainers.size(); i++)
+		{
+			if (m_chunkContainers[i].chunk && m_chunkContainers[i].chunk->hasFullyLoaded)
+				updateDrawingBuffers(i);
 		}
+	}
 
-		// Assign the leftmost containers, or generate them if necessary
-		for (int i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			glm::vec2 chunkPosition = glm::vec2(chunkContainerOriginPos.x - 1, chunkContainerOriginPos.y + i);
-			Chunk* chunk = m_terrain->getChunk(chunkPosition);
-			if (!chunk)
-			{
-				chunk = m_terrain->createChunk(chunkPosition);
-				chunks.push_back(chunk);
-			}
+	if (Input::getInstance()->isKeyPressed(GLFW_KEY_U))
+	{
+		UploadStats stats = m_uploadBuffer->getLastFrameStats();
+		Output::log("Terrain uploads last frame: " + std::to_string(stats.uploadCount) + " uploads, " + std::to_string(stats.bytesUploaded) + " bytes, " +
+			std::to_string(stats.stallCount) + " stalls (" + std::to_string(stats.stallTime) + " ms)" + (m_uploadBuffer->isPersistent() ? "" : " using glBufferSubData"));
+	}
+#endif
+}
+
+void TerrainRenderer::advanceAnimationTime(float deltaTime)
+{
+	m_animationTime = fmod(m_animationTime + deltaTime, TERRAIN_ANIMATION_TIME_WRAP);
+}
 
-			chunk->containerIndex = i * (CHUNK_CONTAINER_DISTANCE + 1);
+void TerrainRenderer::endFrame()
+{
+	RenderQueue::getInstance()->record(this, COMMAND_END_FRAME, 0);
+}
 
-			ChunkContainer& chunkContainer = m_chunkContainers[chunk->containerIndex];
-			chunkContainer.chunk = chunk;
+void TerrainRenderer::updateDrawingBuffers(const size_t containerIndex)
+{
+	ChunkContainer& chunkContainer = m_chunkContainers[containerIndex];
+	Chunk* chunk = chunkContainer.chunk;
 
-			if (chunk->hasFullyLoaded)
-				updateDrawingBuffers(chunk->containerIndex);
-		}
+	// The chunk is locked in case a cave worm is still changing it
+	std::unique_lock<std::mutex> lock(chunk->mutex);
 
-		// Shift the chunk container origin by 1 chunk
-		m_chunkContainerOriginWorldPos.x -= CHUNK_SIZE * BLOCK_SIZE;
+	// Chunks of only air have nothing to draw
+	if (chunk->blockCount[AIR] == Chunk::Layout::blockCount)
+	{
+		chunkContainer.hasInstances = false;
+		return;
 	}
 
-	// Check if we need to update the chunk containers from the top
-	if (cameraPosition.y + cameraHeight * 0.5f + CAMERA_VIEW_BUFFER_CONTAINER_REASSIGN >= m_chunkContainerOriginWorldPos.y + CHUNK_SIZE * BLOCK_SIZE * (CHUNK_CONTAINER_DISTANCE + 1) && cameraPosition.y + cameraHeight * 0.5f <= TERRAIN_CHUNK_HEIGHT * CHUNK_SIZE * BLOCK_SIZE)
-	{
-		// Converts the chunk containers' origin to chunk coordinates
-		glm::vec2 chunkContainerOriginPos = Terrain::worldToChunkCoords(m_chunkContainerOriginWorldPos);
+	// The instances were already built by the worker that generated or modified the chunk, so they only need to be
+	// copied into the container's region of the instance buffer. They're copied into the command while the chunk is locked.
+	UploadCommand* command = RenderQueue::getInstance()->record<UploadCommand>(this, COMMAND_UPLOAD, Chunk::Layout::uploadBytes);
+	command->containerIndex = containerIndex;
+	memcpy_s(command + 1, Chunk::Layout::uploadBytes, chunk->instances, Chunk::Layout::uploadBytes);
 
-		// Unassign the bottommost chunks from the chunk containers
-		for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			ChunkContainer& chunkContainer = m_chunkContainers[i];
-			chunkContainer.chunk->containerIndex = -1;
-			chunkContainer.chunk = nullptr;
+	chunkContainer.hasInstances = true;
+}
 
-			clearWorldPositions(chunkContainer);
-			clearUVOffsetIndices(chunkContainer);
-		}
+void TerrainRenderer::buildInstances(const Block* blocks, TerrainInstance* instances)
+{
+	// Instances are kept in block order, since the shader works out each block's position from its instance index
+	for (size_t i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+	{
+		instances[i].blockType = (unsigned char)blocks[i].blockType;
+		instances[i].uvOffsetIndex = (unsigned char)blocks[i].renderable.uvOffsetIndex;
+	}
 
-		// Reassign the existing chunk containers
-		size_t chunkContainerIndex = CHUNK_CONTAINER_DISTANCE + 1;
-		for (size_t j = 0; j < CHUNK_CONTAINER_DISTANCE; j++)
+	// The lower detail levels are built once here, rather than each time the camera zooms out
+	for (int level = 1; level < TERRAIN_LOD_LEVELS; level++)
+	{
+		int tilesWide = CHUNK_SIZE >> level;
+		for (int tileY = 0; tileY < tilesWide; tileY++)
 		{
-			for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
+			for (int tileX = 0; tileX < tilesWide; tileX++)
 			{
-				ChunkContainer& chunkContainer = m_chunkContainers[chunkContainerIndex];
-				chunkContainer.chunk->containerIndex -= (CHUNK_CONTAINER_DISTANCE + 1);
-				m_chunkContainers[chunkContainerIndex - (CHUNK_CONTAINER_DISTANCE + 1)].chunk = chunkContainer.chunk;
-
-				if (chunkContainer.chunk->hasFullyLoaded)
-					updateDrawingBuffers(chunkContainerIndex - (CHUNK_CONTAINER_DISTANCE + 1));
-
-				chunkContainerIndex++;
+				buildLodTile(blocks, instances, level, tileX, tileY);
 			}
 		}
+	}
+}
 
-		// Assign the topmost containers, or generate them if necessary
-		for (int i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			glm::vec2 chunkPosition = glm::vec2(chunkContainerOriginPos.x + i, chunkContainerOriginPos.y + (CHUNK_CONTAINER_DISTANCE + 1));
-			Chunk* chunk = m_terrain->getChunk(chunkPosition);
-			if (!chunk)
-			{
-				chunk = m_terrain->createChunk(chunkPosition);
-				chunks.push_back(chunk);
-			}
+void TerrainRenderer::updateInstances(const Block* blocks, TerrainInstance* instances, int blockX, int blockY)
+{
+	// Only the changed block and the one tile containing it at each detail level need rebuilding
+	size_t blockIndex = blockX + blockY * CHUNK_SIZE;
+	instances[blockIndex].blockType = (unsigned char)blocks[blockIndex].blockType;
+	instances[blockIndex].uvOffsetIndex = (unsigned char)blocks[blockIndex].renderable.uvOffsetIndex;
 
-			chunk->containerIndex = (CHUNK_CONTAINER_SIZE - 1) - CHUNK_CONTAINER_DISTANCE + i;
+	for (int level = 1; level < TERRAIN_LOD_LEVELS; level++)
+	{
+		buildLodTile(blocks, instances, level, blockX >> level, blockY >> level);
+	}
+}
 
-			ChunkContainer& chunkContainer = m_chunkContainers[chunk->containerIndex];
-			chunkContainer.chunk = chunk;
+void TerrainRenderer::render(const Camera& camera)
+{
+	// Every chunk is drawn at the same detail level, picked from the camera's zoom
+	int lodLevel = getLodLevel(camera);
+
+	// Make room for a draw command for every container, since it isn't known yet how many will be visible
+	size_t containerCount = m_chunkContainers.size();
+	size_t extraDataSize = (sizeof(glm::vec2) + sizeof(DrawElementsIndirectCommand)) * containerCount;
+	DrawCommand* command = RenderQueue::getInstance()->record<DrawCommand>(this, COMMAND_DRAW, extraDataSize);
+
+	// The assets are resolved here rather than on the render thread, since the asset manager's tables grow as assets load
+	AssetManager* assetManager = AssetManager::getInstance();
+	command->shaderID = assetManager->getShader(m_shaderHandle);
+	command->textureID = assetManager->getTexture(m_textureHandle).id;
+	command->lodLevel = lodLevel;
+	command->animationTime = (float)m_animationTime;
+	command->drawCount = 0;
+	command->containerCount = (unsigned int)containerCount;
+
+	glm::vec2* chunkOrigins = reinterpret_cast<glm::vec2*>(command + 1);
+	DrawElementsIndirectCommand* drawCommands = reinterpret_cast<DrawElementsIndirectCommand*>(chunkOrigins + containerCount);
+	m_cullStats = CullStats();
+
+	// Build a draw command for each visible container with a loaded chunk. The container index is passed through the base vertex,
+	// so the shader can look up the chunk's origin from gl_VertexID. Containers only around the view are uploaded but not drawn.
+	for (unsigned int i = 0; i < containerCount; i++)
+	{
+		chunkOrigins[i] = glm::vec2();
 
-			if (chunk->hasFullyLoaded)
-				updateDrawingBuffers(chunk->containerIndex);
+		const ChunkContainer& chunkContainer = m_chunkContainers[i];
+		if (!chunkContainer.chunk || !chunkContainer.chunk->hasFullyLoaded || !chunkContainer.hasInstances) continue;
+		if (!m_visibleRect.contains(chunkContainer.chunk->chunkPosition))
+		{
+			m_cullStats.culledCount++;
+			continue;
 		}
 
-		// Shift the chunk container origin by 1 chunk
-		m_chunkContainerOriginWorldPos.y += CHUNK_SIZE * BLOCK_SIZE;
+		m_cullStats.drawnCount++;
+
+		// Block positions are relative to their chunk, so the chunk's position relative to the floating origin is added in the shader
+		chunkOrigins[i] = m_terrain->chunkToWorldCoords(chunkContainer.chunk->chunkPosition);
+
+		DrawElementsIndirectCommand& drawCommand = drawCommands[command->drawCount++];
+		drawCommand.count = 6;
+		drawCommand.instanceCount = Chunk::Layout::lodTileCount(lodLevel);
+		drawCommand.firstIndex = 0;
+		drawCommand.baseVertex = i * 4;
+		drawCommand.baseInstance = i * Chunk::Layout::instanceCount + Chunk::Layout::lodOffset(lodLevel);
 	}
+}
 
-	// Check if we need to update the chunk containers from the bottom
-	if (cameraPosition.y - cameraHeight * 0.5f - CAMERA_VIEW_BUFFER_CONTAINER_REASSIGN <= m_chunkContainerOriginWorldPos.y && cameraPosition.y - cameraHeight * 0.5f >= -TERRAIN_CHUNK_HEIGHT * CHUNK_SIZE * BLOCK_SIZE)
+void TerrainRenderer::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice::getInstance()->setRenderPass(RENDER_PASS_TERRAIN);
+
+	switch (type)
 	{
-		// Converts the chunk containers' origin to chunk coordinates
-		glm::vec2 chunkContainerOriginPos = Terrain::worldToChunkCoords(m_chunkContainerOriginWorldPos);
+	case COMMAND_RESIZE_POOL:
+		executeResizePool(*static_cast<const ResizePoolCommand*>(data));
+		break;
+	case COMMAND_UPLOAD:
+		executeUpload(*static_cast<const UploadCommand*>(data));
+		break;
+	case COMMAND_DRAW:
+		executeDraw(*static_cast<const DrawCommand*>(data));
+		break;
+	case COMMAND_END_FRAME:
+		m_uploadBuffer->endFrame();
+		break;
+	}
+}
 
-		// Unassign the topmost chunks from the chunk containers
-		for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			ChunkContainer& chunkContainer = m_chunkContainers[i + (CHUNK_CONTAINER_SIZE - 1) - CHUNK_CONTAINER_DISTANCE];
-			chunkContainer.chunk->containerIndex = -1;
-			chunkContainer.chunk = nullptr;
+void TerrainRenderer::executeUpload(const UploadCommand& command)
+{
+	m_uploadBuffer->upload(m_instanceBuffer, Chunk::Layout::uploadBytes * command.containerIndex, &command + 1, Chunk::Layout::uploadBytes);
+}
 
-			clearWorldPositions(chunkContainer);
-			clearUVOffsetIndices(chunkContainer);
-		}
+void TerrainRenderer::executeDraw(const DrawCommand& command)
+{
+	if (command.drawCount == 0) return;
 
-		// Reassign the existing chunk containers
-		size_t chunkContainerIndex = (CHUNK_CONTAINER_SIZE - 1) - (CHUNK_CONTAINER_DISTANCE + 1);
-		for (size_t j = 0; j < CHUNK_CONTAINER_DISTANCE; j++)
-		{
-			for (size_t i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-			{
-				ChunkContainer& chunkContainer = m_chunkContainers[chunkContainerIndex];
-				chunkContainer.chunk->containerIndex += (CHUNK_CONTAINER_DISTANCE + 1);
-				m_chunkContainers[chunkContainerIndex + (CHUNK_CONTAINER_DISTANCE + 1)].chunk = chunkContainer.chunk;
+	const glm::vec2* chunkOrigins = reinterpret_cast<const glm::vec2*>(&command + 1);
+	const DrawElementsIndirectCommand* drawCommands = reinterpret_cast<const DrawElementsIndirectCommand*>(chunkOrigins + command.containerCount);
 
-				if (chunkContainer.chunk->hasFullyLoaded)
-					updateDrawingBuffers(chunkContainerIndex + (CHUNK_CONTAINER_DISTANCE + 1));
+	GraphicsDevice* device = GraphicsDevice::getInstance();
 
-				chunkContainerIndex--;
-			}
-		}
+	// Use the shader
+	device->useProgram(command.shaderID);
 
-		// Assign the bottommost containers, or generate them if necessary
-		for (int i = 0; i < CHUNK_CONTAINER_DISTANCE + 1; i++)
-		{
-			glm::vec2 chunkPosition = glm::vec2(chunkContainerOriginPos.x + i, chunkContainerOriginPos.y - 1);
-			Chunk* chunk = m_terrain->getChunk(chunkPosition);
-			if (!chunk)
-			{
-				chunk = m_terrain->createChunk(chunkPosition);
-				chunks.push_back(chunk);
-			}
+	// Upload a tint color
+	device->uniform4f(5, 1.0f, 1.0f, 1.0f, 1.0f);
 
-			chunk->containerIndex = i;
+	// Upload the detail level
+	device->uniform1i(6, command.lodLevel);
 
-			ChunkContainer& chunkContainer = m_chunkContainers[chunk->containerIndex];
-			chunkContainer.chunk = chunk;
+	// Upload the animation time. Blocks are animated entirely in the shader, so they never have to be rebuilt or re-uploaded to animate.
+	device->uniform1f(7, command.animationTime);
 
-			if (chunk->hasFullyLoaded)
-				updateDrawingBuffers(chunk->containerIndex);
-		}
+	// Upload the chunk containers' origins. The pool's size changes with the view, so they're kept in a storage buffer rather than a uniform array.
+	device->bindBuffer(GL_SHADER_STORAGE_BUFFER, m_chunkOriginBuffer);
+	device->bufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glm::vec2) * command.containerCount, chunkOrigins);
 
-		// Shift the chunk container origin by 1 chunk
-		m_chunkContainerOriginWorldPos.y -= CHUNK_SIZE * BLOCK_SIZE;
-	}
+	// Bind the texture, the material table and the chunk origins
+	device->bindTexture(command.textureID);
+	device->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_materialBuffer);
+	device->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_chunkOriginBuffer);
 
-	return chunks;
-}
+	device->bindVertexArray(m_vao);
 
-void TerrainRenderer::update(const Camera& camera)
-{
-#ifdef _DEBUG
-	if (Input::getInstance()->isKeyPressed(GLFW_KEY_F))
+	// Draw every chunk with a single call
+	device->bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	device->bufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * command.drawCount, drawCommands);
+	device->multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_BYTE, 0, command.drawCount, 0);
+
+	// The device can't see the instance counts in the indirect buffer, so they're counted from the draw commands
+	size_t instanceCount = 0;
+	for (unsigned int i = 0; i < command.drawCount; i++)
 	{
-		for (size_t i = 0; i < CHUNK_CONTAINER_SIZE; i++)
-		{
-			if (m_chunkContainers[i].chunk->hasFullyLoaded)
-				updateDrawingBuffers(i);
-		}
+		instanceCount += drawCommands[i].instanceCount;
 	}
-#endif
+	device->countIndirectDraws(instanceCount, instanceCount * 2);
 }
 
-void TerrainRenderer::updateDrawingBuffers(const size_t containerIndex)
+const CullStats& TerrainRenderer::getLastFrameCullStats() const
 {
-	const ChunkContainer& chunkContainer = m_chunkContainers[containerIndex];
+	return m_cullStats;
+}
 
-	// Cache the blocks pointer and the blockIndexMap pointer
-	Block* blocks = chunkContainer.chunk->blocks;
-	unsigned int* blockIndexMap = chunkContainer.chunk->blockIndexMap;
+size_t TerrainRenderer::calculateRequiredContainerCount(const Camera& camera) const
+{
+	// A view can overlap one more chunk than it spans in each direction, depending on where it's aligned
+	float chunkWorldSize = CHUNK_SIZE * BLOCK_SIZE;
+	glm::vec2 viewSize = camera.getViewSize();
+	size_t width = (size_t)ceilf(viewSize.x / chunkWorldSize) + 1 + CHUNK_CONTAINER_PREFETCH * 2;
+	size_t height = (size_t)ceilf(viewSize.y / chunkWorldSize) + 1 + CHUNK_CONTAINER_PREFETCH * 2;
 
-	// Collect the container's world positions (in sorted order)
-	glm::vec2 worldPositions[CHUNK_SIZE * CHUNK_SIZE];
-	for (size_t i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
-	{
-		worldPositions[i] = blocks[blockIndexMap[i]].transform.position;
-	}
+	return width * height;
+}
 
-	// Collect the container's uv offset indices (in sorted order)
-	unsigned int uvOffsetIndices[CHUNK_SIZE * CHUNK_SIZE];
-	for (size_t i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+void TerrainRenderer::resizeContainerPool(size_t containerCount)
+{
+	size_t oldContainerCount = m_chunkContainers.size();
+
+	// Chunks in containers past the end of a shrunk pool lose their container
+	for (size_t i = containerCount; i < oldContainerCount; i++)
 	{
-		uvOffsetIndices[i] = blocks[blockIndexMap[i]].renderable.uvOffsetIndex;
+		releaseContainer((int)i);
 	}
 
-	// Update the container's world positions
-	glBindBuffer(GL_ARRAY_BUFFER, chunkContainer.worldPositionsVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec2) * CHUNK_SIZE * CHUNK_SIZE, &worldPositions[0][0]);
+	m_chunkContainers.resize(containerCount, ChunkContainer());
 
-	// Update the container's uv offset indices
-	glBindBuffer(GL_ARRAY_BUFFER, chunkContainer.uvOffsetIndicesVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(unsigned int) * CHUNK_SIZE * CHUNK_SIZE, &uvOffsetIndices[0]);
+	ResizePoolCommand* command = RenderQueue::getInstance()->record<ResizePoolCommand>(this, COMMAND_RESIZE_POOL);
+	command->oldContainerCount = oldContainerCount;
+	command->containerCount = containerCount;
+
+	Output::log("Resized the chunk container pool from " + std::to_string(oldContainerCount) + " to " + std::to_string(containerCount) + " containers");
 }
 
-void TerrainRenderer::render(const Camera& camera) const
+void TerrainRenderer::executeResizePool(const ResizePoolCommand& command)
 {
-	const glm::mat4& projection = camera.getProjectionMatrix();
-	const glm::mat4& view = camera.getViewMatrix();
+	size_t containerCount = command.containerCount;
+	size_t containerBytes = Chunk::Layout::uploadBytes;
 
-	AssetManager* assetManager = AssetManager::getInstance();
-	unsigned int terrainShaderID = assetManager->getShader("terrainShader");
-	unsigned int blockSpritesheet = assetManager->getTexture("blockSpritesheet");
+	GraphicsDevice* device = GraphicsDevice::getInstance();
 
-	// Use the shader
-	glUseProgram(terrainShaderID);
+	// Make a new instance buffer and copy the containers that survived into it on the GPU, so they don't have to be uploaded again
+	unsigned int instanceBuffer = device->createBuffer();
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, instanceBuffer);
+	device->bufferData(GL_COPY_WRITE_BUFFER, containerBytes * containerCount, nullptr, GL_DYNAMIC_DRAW);
 
-	// Upload the matrices
-	glUniformMatrix4fv(0, 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(1, 1, GL_FALSE, &view[0][0]);
+	size_t keptContainerCount = std::min(command.oldContainerCount, containerCount);
+	if (keptContainerCount > 0)
+	{
+		device->bindBuffer(GL_COPY_READ_BUFFER, m_instanceBuffer);
+		device->copyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, containerBytes * keptContainerCount);
+		device->bindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
 
-	// Upload a tint color
-	glUniform4f(5, 1.0f, 1.0f, 1.0f, 1.0f);
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-	// Bind the texture
-	glBindTexture(GL_TEXTURE_2D, blockSpritesheet);
+	device->deleteBuffer(m_instanceBuffer);
+	m_instanceBuffer = instanceBuffer;
 
-	for (size_t i = 0; i < CHUNK_CONTAINER_SIZE; i++)
+	// Point the VAO at the new instance buffer
+	device->bindVertexArray(m_vao);
+	device->bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	device->enableVertexAttribArray(0);
+	device->vertexAttribIPointer(0, 2, GL_UNSIGNED_BYTE, sizeof(TerrainInstance), 0);
+	device->vertexAttribDivisor(0, 1);
+	device->bindVertexArray(0);
+
+	// Draw commands and chunk origins, one per chunk container at most
+	device->bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	device->bufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * containerCount, nullptr, GL_DYNAMIC_DRAW);
+
+	device->bindBuffer(GL_SHADER_STORAGE_BUFFER, m_chunkOriginBuffer);
+	device->bufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::vec2) * containerCount, nullptr, GL_DYNAMIC_DRAW);
+	device->bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int TerrainRenderer::findFreeContainer() const
+{
+	// Use an empty container if there is one, otherwise evict the least recently used chunk that isn't needed this frame
+	int leastRecentlyUsed = -1;
+	for (size_t i = 0; i < m_chunkContainers.size(); i++)
 	{
-		if (m_chunkContainers[i].chunk && m_chunkContainers[i].chunk->hasFullyLoaded)
-		{
-			// Bind the chunk's VAO
-			glBindVertexArray(m_chunkContainers[i].vao);
+		const ChunkContainer& chunkContainer = m_chunkContainers[i];
+		if (!chunkContainer.chunk)
+			return (int)i;
 
-			unsigned int blockCountSum = 0;
-			for (size_t j = 1; j < BLOCK_COUNT; j++)
-			{
-				// Add to the block sum so the instance offset is consistent
-				blockCountSum += m_chunkContainers[i].chunk->blockCount[j - 1];
+		if (chunkContainer.lastUsedFrame != m_frame && (leastRecentlyUsed < 0 || chunkContainer.lastUsedFrame < m_chunkContainers[leastRecentlyUsed].lastUsedFrame))
+			leastRecentlyUsed = (int)i;
+	}
+
+	return leastRecentlyUsed;
+}
 
-				// Don't render this block type if there aren't any present in the chunk
-				if (m_chunkContainers[i].chunk->blockCount[j] == 0) continue;
+void TerrainRenderer::assignContainer(int containerIndex, Chunk* chunk)
+{
+	// Unassign the chunk that was least recently used
+	releaseContainer(containerIndex);
 
-				// Gets the render data for the current block
-				const Renderable& blockRenderData = BlockContainer::getBlockRenderData((BlockType)j);
-				const Texture& blockTexture = blockRenderData.texture;
-				glm::vec2 blockTileDimensions = blockRenderData.tileDimensions;
-				const glm::vec2* blockUVOffsets = blockRenderData.uvOffsets;
+	ChunkContainer& chunkContainer = m_chunkContainers[containerIndex];
+	chunkContainer.chunk = chunk;
+	chunkContainer.lastUsedFrame = m_frame;
 
-				// Upload uniforms
-				glm::vec2 uvOffsetScaleFactor = blockTexture.dimensions / (blockTileDimensions - glm::vec2(TEXTURE_SHRINK_FACTOR));
-				glUniform2fv(4, 1, &uvOffsetScaleFactor[0]);
-				glUniform2fv(6, MAX_ANIMATION_LENGTH, &blockUVOffsets[0][0]);
+	chunk->containerIndex = containerIndex;
 
-				// Draw the block using instanced rendering
-				glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, (void*)0, m_chunkContainers[i].chunk->blockCount[j], blockCountSum);
-			}
+	// Chunks that are still generating will be uploaded once they've fully loaded
+	if (chunk->hasFullyLoaded)
+		updateDrawingBuffers(containerIndex);
+}
+
+void TerrainRenderer::buildLodTile(const Block* blocks, TerrainInstance* instances, int level, int tileX, int tileY)
+{
+	// A tile takes the most common block type among the blocks it covers. Solid blocks win ties with air,
+	// so thin features like the grass on the surface don't disappear when zoomed out.
+	int tileSize = 1 << level;
+	unsigned int counts[BLOCK_COUNT] = {};
+	const Block* firstBlocks[BLOCK_COUNT] = {};
+
+	for (int j = tileY * tileSize; j < (tileY + 1) * tileSize; j++)
+	{
+		for (int i = tileX * tileSize; i < (tileX + 1) * tileSize; i++)
+		{
+			const Block& block = blocks[i + j * CHUNK_SIZE];
+			if (counts[block.blockType]++ == 0)
+				firstBlocks[block.blockType] = &block;
 		}
 	}
+
+	int majorityType = AIR;
+	for (int i = AIR + 1; i < BLOCK_COUNT; i++)
+	{
+		if (counts[i] > counts[majorityType] || (majorityType == AIR && counts[i] > 0 && counts[i] == counts[AIR]))
+			majorityType = i;
+	}
+
+	TerrainInstance& instance = instances[Chunk::Layout::lodOffset(level) + tileX + tileY * (CHUNK_SIZE >> level)];
+	instance.blockType = (unsigned char)majorityType;
+	instance.uvOffsetIndex = (unsigned char)firstBlocks[majorityType]->renderable.uvOffsetIndex;
 }
 
-void TerrainRenderer::clearWorldPositions(const ChunkContainer& chunkContainer)
-{
-	glm::vec2 worldPositions[CHUNK_SIZE * CHUNK_SIZE];
-	memset(worldPositions, 0, CHUNK_SIZE * CHUNK_SIZE);
+// Without a detail level for every halving of the zoom, zooming out past the coarsest one would draw more instances than the default view
+static_assert(CAMERA_ZOOM_MIN * (1 << (TERRAIN_LOD_LEVELS - 1)) >= 1.0f, "There must be a terrain detail level for the camera's minimum zoom");
 
-	glBindBuffer(GL_ARRAY_BUFFER, chunkContainer.worldPositionsVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec2) * CHUNK_SIZE * CHUNK_SIZE, &worldPositions[0][0]);
+int TerrainRenderer::getLodLevel(const Camera& camera)
+{
+	// Each time the view doubles in size the tiles double in size too, so the instance count stays about the same
+	int lodLevel = (int)floorf(-log2f(camera.getZoom()));
+	return std::min(std::max(lodLevel, 0), TERRAIN_LOD_LEVELS - 1);
 }
 
-void TerrainRenderer::clearUVOffsetIndices(const ChunkContainer& chunkContainer)
+void TerrainRenderer::uploadMaterialTable()
 {
-	unsigned int uvOffsetIndices[CHUNK_SIZE * CHUNK_SIZE];
-	memset(uvOffsetIndices, 0, CHUNK_SIZE * CHUNK_SIZE);
+	// Every block's render data is uploaded once, so the shader can look it up by block type instead of
+	// having it uploaded as uniforms for each block type each frame. All blocks share the block spritesheet.
+	TerrainMaterial materials[BLOCK_COUNT];
+	for (size_t i = 0; i < BLOCK_COUNT; i++)
+	{
+		const Renderable& blockRenderData = BlockContainer::getBlockRenderData((BlockType)i);
+
+		materials[i].uvOffsetScaleFactor = blockRenderData.texture.getUVOffsetScaleFactor(blockRenderData.tileDimensions);
+		materials[i].frameCount = blockRenderData.frameCount;
+		materials[i].frameRate = blockRenderData.frameRate;
+
+		// The spritesheet's tiles are moved to where they are in the atlas. Air has no texture, so it has nothing to move.
+		for (int j = 0; j < MAX_ANIMATION_LENGTH; j++)
+		{
+			const Texture& texture = blockRenderData.texture;
+			materials[i].uvOffsets[j] = texture.id != 0 ? texture.getUVOffset(blockRenderData.uvOffsets[j], blockRenderData.tileDimensions) : glm::vec2();
+		}
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, chunkContainer.uvOffsetIndicesVBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(unsigned int) * CHUNK_SIZE * CHUNK_SIZE, &uvOffsetIndices[0]);
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	m_materialBuffer = device->createBuffer();
+	device->bindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	device->bufferData(GL_SHADER_STORAGE_BUFFER, sizeof(TerrainMaterial) * BLOCK_COUNT, materials, GL_STATIC_DRAW);
+	device->bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
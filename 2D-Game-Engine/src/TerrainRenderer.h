@@ -1,48 +1,153 @@
 #pragma once
 
+#include "AssetID.h"
 #include "Camera.h"
+#include "ChunkCoords.h"
+#include "ChunkLayout.h"
+#include "RenderQueue.h"
 
-#define CHUNK_CONTAINER_DISTANCE 2 // How many chunk containers in one direction excluding the center - must be an even number
+#define CHUNK_CONTAINER_PREFETCH 1 // Number of chunks around the camera's view that are uploaded before they become visible
+#define CHUNK_CONTAINER_POOL_SLACK 0.5f // Fraction of extra chunk containers kept so recently seen chunks stay uploaded
 
-// The number of chunk containers (number of renderable chunks)
-#define CHUNK_CONTAINER_SIZE (CHUNK_CONTAINER_DISTANCE + 1) * (CHUNK_CONTAINER_DISTANCE + 1)
-
-#define CAMERA_VIEW_BUFFER_CONTAINER_REASSIGN 128 // Number of pixels to add to the camera's edge when checking for chunk container reassignment
+#define TERRAIN_ANIMATION_TIME_WRAP 3600.0 // Number of seconds after which the animation time wraps, so it doesn't lose precision as a float
 
 class Terrain;
-struct Chunk;
+class UploadRingBuffer;
+
+// A block type's render data, laid out to match the material table in the terrain shader (std430)
+struct TerrainMaterial
+{
+	glm::vec2 uvOffsetScaleFactor;
+	unsigned int frameCount;
+	float frameRate;
+	glm::vec2 uvOffsets[MAX_ANIMATION_LENGTH];
+};
+
+// The per-block instance data in the shared instance buffer. There's one for every block in the chunk, in block order,
+// so the shader works out the block's position from its instance index. Lower detail levels follow with one per tile of blocks.
+struct TerrainInstance
+{
+	unsigned char blockType;
+	unsigned char uvOffsetIndex;
+};
+
+static_assert(BLOCK_COUNT <= 256 && MAX_ANIMATION_LENGTH <= 256, "Block types and uv offset indices must fit in a TerrainInstance");
+
+// The layout glMultiDrawElementsIndirect reads its draw commands in
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
 
 struct ChunkContainer
 {
 	Chunk* chunk;
-	unsigned int vao;
-	unsigned int worldPositionsVBO;
-	unsigned int uvOffsetIndicesVBO;
+	unsigned int lastUsedFrame; // The last frame the chunk was around the camera's view, used to evict the least recently used container
+	bool hasInstances; // Whether the chunk's blocks have been uploaded to the container's region of the instance buffer and aren't all air
 };
 
-class TerrainRenderer
+// Records the terrain's uploads and draws into the render queue. Everything touching GL runs on the render thread,
+// while the chunk containers themselves are managed by the simulation.
+class TerrainRenderer : public RenderCommandHandler
 {
 public:
-	TerrainRenderer(Terrain* terrain, unsigned int vertexBufferID, unsigned int indexBufferID);
+	TerrainRenderer(Terrain* terrain, unsigned int indexBufferID);
 	~TerrainRenderer();
 
-	void initChunkContainers(std::vector<Chunk*> chunks, glm::vec2 startingChunkPosition);
-	std::vector<Chunk*> checkShiftChunkContainers(const Camera& camera);
+	std::vector<Chunk*> updateChunkContainers(const Camera& camera);
+	void releaseContainer(int containerIndex);
+	void releaseContainers();
+
+	ChunkRect getViewChunkRect(const Camera& camera, int buffer) const;
 
 	void update(const Camera& camera);
 
 	void updateDrawingBuffers(const size_t containerIndex);
 
-	void render(const Camera& camera) const;
+	static void buildInstances(const Block* blocks, TerrainInstance* instances);
+	static void updateInstances(const Block* blocks, TerrainInstance* instances, int blockX, int blockY);
+
+	void advanceAnimationTime(float deltaTime);
+	void endFrame();
+
+	void render(const Camera& camera);
+
+	const CullStats& getLastFrameCullStats() const;
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
 
 private:
-	void clearWorldPositions(const ChunkContainer& chunkContainer);
-	void clearUVOffsetIndices(const ChunkContainer& chunkContainer);
+	enum CommandType
+	{
+		COMMAND_RESIZE_POOL,
+		COMMAND_UPLOAD,
+		COMMAND_DRAW,
+		COMMAND_END_FRAME
+	};
+
+	struct ResizePoolCommand
+	{
+		size_t oldContainerCount;
+		size_t containerCount;
+	};
+
+	// Followed by the chunk's instances
+	struct UploadCommand
+	{
+		size_t containerIndex;
+	};
+
+	// Followed by every container's chunk origin, and then the draw commands
+	struct DrawCommand
+	{
+		unsigned int shaderID;
+		unsigned int textureID;
+		int lodLevel;
+		float animationTime;
+		unsigned int drawCount;
+		unsigned int containerCount;
+	};
+
+	void executeResizePool(const ResizePoolCommand& command);
+	void executeUpload(const UploadCommand& command);
+	void executeDraw(const DrawCommand& command);
+
+	size_t calculateRequiredContainerCount(const Camera& camera) const;
+	void resizeContainerPool(size_t containerCount);
+	int findFreeContainer() const;
+	void assignContainer(int containerIndex, Chunk* chunk);
+
+	static void buildLodTile(const Block* blocks, TerrainInstance* instances, int level, int tileX, int tileY);
+	static int getLodLevel(const Camera& camera);
+
+	void uploadMaterialTable();
 
 	Terrain* m_terrain;
-	unsigned int m_vertexBufferID;
 	unsigned int m_indexBufferID;
 
-	ChunkContainer m_chunkContainers[CHUNK_CONTAINER_SIZE];
-	glm::vec2 m_chunkContainerOriginWorldPos;
+	// Only used on the render thread once it has started
+	unsigned int m_vao;
+	unsigned int m_instanceBuffer; // Holds the instances of every chunk container, each in its own region
+	unsigned int m_materialBuffer;
+	unsigned int m_indirectBuffer;
+	unsigned int m_chunkOriginBuffer;
+
+	UploadRingBuffer* m_uploadBuffer;
+
+	// Only used by the simulation
+	// The pool of chunk containers, which grows and shrinks with the camera's view size
+	std::vector<ChunkContainer> m_chunkContainers;
+	ChunkRect m_visibleRect; // The chunks that are on screen this frame
+	CullStats m_cullStats; // Counts the chunk containers, which are culled when drawing
+	unsigned int m_frame;
+
+	// Found once, since the blocks' assets are loaded before the terrain
+	ShaderHandle m_shaderHandle;
+	TextureHandle m_textureHandle;
+
+	double m_animationTime; // Seconds, wrapped every TERRAIN_ANIMATION_TIME_WRAP
 };
@@ -0,0 +1,320 @@
+#include "stdafx.h"
+#include "TextRenderer.h"
+
+#include "AssetManager.h"
+#include "GraphicsDevice.h"
+#include "UploadRingBuffer.h"
+#include "Systems/RenderSystem.h"
+
+// Every printable ASCII character, one row per byte from the top, with the lowest bit as the leftmost pixel
+static const unsigned char glyphs[GLYPH_SOLID][GLYPH_SIZE] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '\''
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\\'
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+};
+
+TextRenderer::TextRenderer(int screenWidth, int screenHeight, unsigned int quadVertexBufferID, unsigned int quadIndexBufferID)
+	: m_screenSize(screenWidth, screenHeight), m_instanceBuffer(0), m_instanceCapacity(0)
+{
+	// Text added before the shader has loaded isn't drawn
+	m_shaderID = 0;
+	AssetManager::getInstance()->loadShaderAsync("textShader", "shaders/textVertexShader.glsl", "shaders/textFragmentShader.glsl", [this](unsigned int shaderID)
+	{
+		m_shaderID = shaderID;
+	});
+
+	// Pack the glyphs into the atlas, with the solid glyph after the last character. The glyphs are white
+	// and only their alpha is used, so the channel order doesn't matter.
+	const int atlasWidth = GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+	const int atlasHeight = GLYPH_ATLAS_ROWS * GLYPH_SIZE;
+	std::vector<unsigned int> atlas(atlasWidth * atlasHeight, 0x00FFFFFF);
+
+	for (int glyph = 0; glyph <= GLYPH_SOLID; glyph++)
+	{
+		int cellX = (glyph % GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+		int cellY = (glyph / GLYPH_ATLAS_COLUMNS) * GLYPH_SIZE;
+
+		for (int y = 0; y < GLYPH_SIZE; y++)
+		{
+			for (int x = 0; x < GLYPH_SIZE; x++)
+			{
+				bool isFilled = glyph == GLYPH_SOLID || (glyphs[glyph][y] >> x) & 1;
+				if (isFilled)
+					atlas[cellX + x + (cellY + y) * atlasWidth] = 0xFFFFFFFF;
+			}
+		}
+	}
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	m_atlasTextureID = device->createTexture(atlasWidth, atlasHeight, true, atlas.data());
+
+	// Glyphs are quads, so they're drawn with the renderer system's quad
+	m_vao = device->createVertexArray();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, quadVertexBufferID);
+	device->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndexBufferID);
+
+	device->enableVertexAttribArray(0);
+	device->vertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(Vertex), 0);
+
+	device->enableVertexAttribArray(1);
+	device->vertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(Vertex), sizeof(float) * 2);
+
+	m_instanceBuffer = device->createBuffer();
+	resizeInstanceBuffer(1024);
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer = new UploadRingBuffer();
+}
+
+TextRenderer::~TextRenderer()
+{
+	delete m_uploadBuffer;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->deleteBuffer(m_instanceBuffer);
+	device->deleteVertexArray(m_vao);
+	device->deleteTexture(m_atlasTextureID);
+}
+
+void TextRenderer::addText(const char* text, glm::vec2 screenPosition, float scale, glm::vec4 color)
+{
+	unsigned int packedColor = packColor(color);
+	float glyphSize = GLYPH_SIZE * scale;
+	glm::vec2 cursor = screenPosition;
+
+	for (const char* character = text; *character; character++)
+	{
+		if (*character == '\n')
+		{
+			cursor = glm::vec2(screenPosition.x, cursor.y + glyphSize);
+			continue;
+		}
+
+		if (*character != ' ')
+		{
+			bool isPrintable = *character >= GLYPH_FIRST_CHARACTER && *character <= '~';
+
+			TextInstance instance;
+			instance.position = cursor;
+			instance.size = glm::vec2(glyphSize);
+			instance.color = packedColor;
+			instance.glyph = (isPrintable ? *character : '?') - GLYPH_FIRST_CHARACTER;
+			m_instances.push_back(instance);
+		}
+
+		cursor.x += glyphSize;
+	}
+}
+
+void TextRenderer::addRect(glm::vec2 screenPosition, glm::vec2 size, glm::vec4 color)
+{
+	TextInstance instance;
+	instance.position = screenPosition;
+	instance.size = size;
+	instance.color = packColor(color);
+	instance.glyph = GLYPH_SOLID;
+	m_instances.push_back(instance);
+}
+
+glm::vec2 TextRenderer::getTextSize(const char* text, float scale) const
+{
+	size_t lineCount = 1;
+	size_t lineLength = 0;
+	size_t longestLineLength = 0;
+
+	for (const char* character = text; *character; character++)
+	{
+		if (*character == '\n')
+		{
+			lineCount++;
+			lineLength = 0;
+			continue;
+		}
+
+		lineLength++;
+		longestLineLength = std::max(longestLineLength, lineLength);
+	}
+
+	return glm::vec2(longestLineLength, lineCount) * (GLYPH_SIZE * scale);
+}
+
+void TextRenderer::setScreenSize(int width, int height)
+{
+	m_screenSize = glm::vec2(width, height);
+}
+
+void TextRenderer::render()
+{
+	if (m_shaderID == 0)
+		m_instances.clear();
+
+	if (m_instances.empty()) return;
+
+	DrawCommand* command = RenderQueue::getInstance()->record<DrawCommand>(this, COMMAND_DRAW, sizeof(TextInstance) * m_instances.size());
+	command->shaderID = m_shaderID;
+	command->screenSize = m_screenSize;
+	command->instanceCount = (unsigned int)m_instances.size();
+
+	memcpy_s(command + 1, sizeof(TextInstance) * m_instances.size(), m_instances.data(), sizeof(TextInstance) * m_instances.size());
+
+	// The vector keeps its capacity, so adding text doesn't allocate once it's grown to fit a frame
+	m_instances.clear();
+}
+
+void TextRenderer::executeRenderCommand(unsigned int type, const void* data, size_t)
+{
+	GraphicsDevice::getInstance()->setRenderPass(RENDER_PASS_TEXT);
+
+	if (type == COMMAND_DRAW)
+		executeDraw(*static_cast<const DrawCommand*>(data));
+}
+
+unsigned int TextRenderer::packColor(glm::vec4 color)
+{
+	glm::uvec4 bytes = glm::uvec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return bytes.r | (bytes.g << 8) | (bytes.b << 16) | (bytes.a << 24);
+}
+
+void TextRenderer::executeDraw(const DrawCommand& command)
+{
+	if (command.instanceCount > m_instanceCapacity)
+		resizeInstanceBuffer(std::max((size_t)command.instanceCount, m_instanceCapacity * 2));
+
+	m_uploadBuffer->upload(m_instanceBuffer, 0, &command + 1, sizeof(TextInstance) * command.instanceCount);
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->useProgram(command.shaderID);
+	device->uniform2f(6, command.screenSize.x, command.screenSize.y);
+	device->bindTexture(m_atlasTextureID);
+	device->bindVertexArray(m_vao);
+
+	device->drawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, command.instanceCount, 0);
+
+	device->bindVertexArray(0);
+
+	m_uploadBuffer->endFrame();
+}
+
+void TextRenderer::resizeInstanceBuffer(size_t instanceCapacity)
+{
+	m_instanceCapacity = instanceCapacity;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindVertexArray(m_vao);
+
+	device->bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	device->bufferData(GL_ARRAY_BUFFER, sizeof(TextInstance) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+
+	// Position and size
+	device->enableVertexAttribArray(2);
+	device->vertexAttribPointer(2, 4, GL_FLOAT, false, sizeof(TextInstance), 0);
+	device->vertexAttribDivisor(2, 1);
+
+	// Color
+	device->enableVertexAttribArray(3);
+	device->vertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, true, sizeof(TextInstance), sizeof(glm::vec2) * 2);
+	device->vertexAttribDivisor(3, 1);
+
+	// Glyph
+	device->enableVertexAttribArray(4);
+	device->vertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(TextInstance), sizeof(glm::vec2) * 2 + sizeof(unsigned int));
+	device->vertexAttribDivisor(4, 1);
+
+	device->bindVertexArray(0);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "RenderQueue.h"
+
+#define GLYPH_SIZE 8 // The width and height of a glyph in the atlas in pixels
+#define GLYPH_ATLAS_COLUMNS 16 // The number of glyphs in each row of the atlas
+#define GLYPH_ATLAS_ROWS 6 // The number of rows of glyphs in the atlas
+#define GLYPH_FIRST_CHARACTER ' ' // The character of the first glyph, after which each printable ASCII character follows in order
+#define GLYPH_SOLID 95 // The glyph that's filled in completely, used for rectangles
+
+// A glyph's per-instance data in the instance buffer
+struct TextInstance
+{
+	glm::vec2 position; // The top left corner in pixels
+	glm::vec2 size;
+	unsigned int color; // RGBA with 8 bits each, red in the lowest byte
+	unsigned int glyph;
+};
+
+class UploadRingBuffer;
+
+// Draws text and solid rectangles over the screen, in pixels from the top left corner. The glyphs are a built in
+// 8x8 font packed into an atlas once at startup. Everything added during a frame is drawn with a single instanced call.
+class TextRenderer : public RenderCommandHandler
+{
+public:
+	// The quad buffers are shared with the renderer system
+	TextRenderer(int screenWidth, int screenHeight, unsigned int quadVertexBufferID, unsigned int quadIndexBufferID);
+	~TextRenderer();
+
+	// Newlines start a new line under the first one. Characters that aren't printable ASCII are drawn as '?'.
+	void addText(const char* text, glm::vec2 screenPosition, float scale = 1.0f, glm::vec4 color = glm::vec4(1.0f));
+	void addRect(glm::vec2 screenPosition, glm::vec2 size, glm::vec4 color);
+
+	glm::vec2 getTextSize(const char* text, float scale = 1.0f) const;
+
+	void setScreenSize(int width, int height);
+
+	// Records everything added this frame into the render queue
+	void render();
+
+	void executeRenderCommand(unsigned int type, const void* data, size_t size) override;
+
+private:
+	enum CommandType
+	{
+		COMMAND_DRAW
+	};
+
+	// Followed by the instances
+	struct DrawCommand
+	{
+		unsigned int shaderID;
+		glm::vec2 screenSize;
+		unsigned int instanceCount;
+	};
+
+	static unsigned int packColor(glm::vec4 color);
+
+	void executeDraw(const DrawCommand& command);
+	void resizeInstanceBuffer(size_t instanceCapacity);
+
+	// Only used by the simulation
+	std::vector<TextInstance> m_instances;
+	glm::vec2 m_screenSize;
+	unsigned int m_shaderID; // 0 until the shader has loaded, and passed to the render thread with each draw
+
+	// Only used on the render thread once it has started
+	unsigned int m_atlasTextureID;
+	unsigned int m_vao;
+	unsigned int m_instanceBuffer;
+	size_t m_instanceCapacity;
+
+	UploadRingBuffer* m_uploadBuffer;
+};
@@ -0,0 +1,157 @@
+#include "stdafx.h"
+#include "TextureAtlas.h"
+
+#include "GraphicsDevice.h"
+
+TextureAtlas::TextureAtlas(int pageSize, int padding)
+	: m_pageSize(pageSize), m_padding(padding)
+{
+	for (int i = 0; i < TEXTURE_ATLAS_MAX_PAGES; i++)
+	{
+		m_pageTextureIDs[i] = 0;
+	}
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	for (size_t i = 0; i < m_pages.size(); i++)
+	{
+		if (m_pageTextureIDs[i])
+			device->deleteTexture(m_pageTextureIDs[i]);
+	}
+}
+
+Texture TextureAtlas::add(const unsigned char* pixels, int width, int height, glm::ivec2 tileDimensions)
+{
+	std::vector<unsigned int> padded;
+	glm::ivec2 paddedSize;
+	if (!pad(pixels, width, height, tileDimensions, padded, paddedSize))
+		return Texture();
+
+	size_t pageIndex;
+	glm::ivec2 position;
+	bool isNewPage;
+	if (!place(paddedSize, pageIndex, position, isNewPage))
+		return Texture();
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	if (isNewPage)
+		setPageTexture(pageIndex, device->createTexture(m_pageSize, m_pageSize, true, nullptr));
+
+	device->updateTexture(getPageTexture(pageIndex), position.x, position.y, paddedSize.x, paddedSize.y, padded.data());
+
+	return getTexture(pageIndex, position, glm::ivec2(width, height));
+}
+
+bool TextureAtlas::pad(const unsigned char* pixels, int width, int height, glm::ivec2 tileDimensions, std::vector<unsigned int>& padded, glm::ivec2& paddedSize) const
+{
+	glm::ivec2 tileCount = glm::ivec2(width, height) / tileDimensions;
+	if (tileCount.x * tileDimensions.x != width || tileCount.y * tileDimensions.y != height)
+		Output::error("ERROR: A " + std::to_string(width) + "x" + std::to_string(height) + " texture isn't a whole number of " +
+			std::to_string(tileDimensions.x) + "x" + std::to_string(tileDimensions.y) + " tiles. The partial tiles are left out of the atlas.");
+
+	// The tiles keep their layout, each spaced out by its padding
+	glm::ivec2 tileStride = tileDimensions + glm::ivec2(m_padding * 2);
+	paddedSize = tileCount * tileStride;
+	if (paddedSize.x == 0 || paddedSize.y == 0 || paddedSize.x > m_pageSize || paddedSize.y > m_pageSize)
+		return false;
+
+	// Each tile's padding repeats the tile's nearest edge pixel
+	const unsigned int* source = reinterpret_cast<const unsigned int*>(pixels);
+	padded.resize(paddedSize.x * paddedSize.y);
+
+	for (int y = 0; y < paddedSize.y; y++)
+	{
+		int tileY = y / tileStride.y;
+		int sourceY = tileY * tileDimensions.y + glm::clamp(y % tileStride.y - m_padding, 0, tileDimensions.y - 1);
+
+		for (int x = 0; x < paddedSize.x; x++)
+		{
+			int tileX = x / tileStride.x;
+			int sourceX = tileX * tileDimensions.x + glm::clamp(x % tileStride.x - m_padding, 0, tileDimensions.x - 1);
+
+			padded[x + y * paddedSize.x] = source[sourceX + sourceY * width];
+		}
+	}
+
+	return true;
+}
+
+bool TextureAtlas::place(glm::ivec2 paddedSize, size_t& pageIndex, glm::ivec2& position, bool& isNewPage)
+{
+	isNewPage = false;
+	for (pageIndex = 0; pageIndex < m_pages.size(); pageIndex++)
+	{
+		if (allocate(m_pages[pageIndex], paddedSize.x, paddedSize.y, position))
+			return true;
+	}
+
+	if (m_pages.size() == TEXTURE_ATLAS_MAX_PAGES)
+		return false;
+
+	Page page;
+	page.nextShelfY = 0;
+	m_pages.push_back(page);
+
+	isNewPage = true;
+	return allocate(m_pages.back(), paddedSize.x, paddedSize.y, position);
+}
+
+void TextureAtlas::setPageTexture(size_t pageIndex, unsigned int textureID)
+{
+	m_pageTextureIDs[pageIndex] = textureID;
+}
+
+unsigned int TextureAtlas::getPageTexture(size_t pageIndex) const
+{
+	return m_pageTextureIDs[pageIndex];
+}
+
+Texture TextureAtlas::getTexture(size_t pageIndex, glm::ivec2 position, glm::ivec2 dimensions) const
+{
+	Texture texture(glm::vec2(dimensions), getPageTexture(pageIndex));
+	texture.pageDimensions = glm::vec2(m_pageSize);
+	texture.atlasPosition = glm::vec2(position);
+	texture.padding = (float)m_padding;
+
+	return texture;
+}
+
+int TextureAtlas::getPageSize() const
+{
+	return m_pageSize;
+}
+
+size_t TextureAtlas::getPageCount() const
+{
+	return m_pages.size();
+}
+
+bool TextureAtlas::allocate(Page& page, int width, int height, glm::ivec2& position)
+{
+	for (size_t i = 0; i < page.shelves.size(); i++)
+	{
+		Shelf& shelf = page.shelves[i];
+		if (height <= shelf.height && shelf.nextX + width <= m_pageSize)
+		{
+			position = glm::ivec2(shelf.nextX, shelf.y);
+			shelf.nextX += width;
+			return true;
+		}
+	}
+
+	if (page.nextShelfY + height > m_pageSize)
+		return false;
+
+	Shelf shelf;
+	shelf.y = page.nextShelfY;
+	shelf.height = height;
+	shelf.nextX = width;
+	page.shelves.push_back(shelf);
+	page.nextShelfY += height;
+
+	position = glm::ivec2(0, shelf.y);
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+
+#include "Components/Renderable.h"
+
+#define TEXTURE_ATLAS_PAGE_SIZE 2048 // The width and height of each atlas page in pixels
+#define TEXTURE_ATLAS_PADDING 2 // The number of edge pixels copied around each tile, so filtering and rounding don't bleed into the next tile
+#define TEXTURE_ATLAS_MAX_PAGES 16 // Textures that don't fit in any page once this many are full get a texture of their own
+
+// Packs textures into shared pages, so sprites with different textures can still be drawn in the same batch.
+// Each texture is split into its tiles and every tile gets its own padding, so spritesheets don't bleed between
+// tiles either. Textures are placed on shelves in the order they're added, and a new page is started when one fills up.
+// Textures can be added all at once with add, or in steps so the padding, placing and uploading can happen on
+// different threads. Pages added in steps only have a texture once the render thread has created it.
+class TextureAtlas
+{
+public:
+	TextureAtlas(int pageSize = TEXTURE_ATLAS_PAGE_SIZE, int padding = TEXTURE_ATLAS_PADDING);
+	~TextureAtlas();
+
+	// The pixels are BGRA rows from the bottom up, like FreeImage loads them. Returns a texture with an ID of 0
+	// if the padded texture is too big for a page, or smaller than a tile. Only call this before the render thread starts.
+	Texture add(const unsigned char* pixels, int width, int height, glm::ivec2 tileDimensions);
+
+	// Spaces out the texture's tiles and fills in their padding. Safe to call from any thread.
+	bool pad(const unsigned char* pixels, int width, int height, glm::ivec2 tileDimensions, std::vector<unsigned int>& padded, glm::ivec2& paddedSize) const;
+
+	// Finds room for a padded texture, starting a new page if needed. Returns false if there's no room left in any page.
+	bool place(glm::ivec2 paddedSize, size_t& pageIndex, glm::ivec2& position, bool& isNewPage);
+
+	void setPageTexture(size_t pageIndex, unsigned int textureID);
+	unsigned int getPageTexture(size_t pageIndex) const;
+
+	// The handle of a texture placed at a position in a page
+	Texture getTexture(size_t pageIndex, glm::ivec2 position, glm::ivec2 dimensions) const;
+
+	int getPageSize() const;
+	size_t getPageCount() const;
+
+private:
+	// A row of textures that are no taller than the row
+	struct Shelf
+	{
+		int y;
+		int height;
+		int nextX;
+	};
+
+	struct Page
+	{
+		std::vector<Shelf> shelves;
+		int nextShelfY;
+	};
+
+	bool allocate(Page& page, int width, int height, glm::ivec2& position);
+
+	// Only used by the thread that places textures
+	std::vector<Page> m_pages;
+
+	// Written by whichever thread creates the page's texture
+	std::atomic<unsigned int> m_pageTextureIDs[TEXTURE_ATLAS_MAX_PAGES];
+
+	int m_pageSize;
+	int m_padding;
+};
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "UploadRingBuffer.h"
+
+#include "GraphicsDevice.h"
+
+#include <chrono>
+
+UploadRingBuffer::UploadRingBuffer(size_t size)
+	: m_buffer(0), m_mappedData(nullptr), m_size(size), m_head(0), m_tail(0), m_fencedHead(0)
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	m_buffer = device->createBuffer();
+	device->bindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+	m_mappedData = (unsigned char*)device->mapPersistentBuffer(GL_COPY_READ_BUFFER, m_size);
+	device->bindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	if (!m_mappedData)
+	{
+		Output::log("Persistent mapped buffers aren't supported, uploads will use glBufferSubData");
+		device->deleteBuffer(m_buffer);
+		m_buffer = 0;
+	}
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	for (size_t i = 0; i < m_fences.size(); i++)
+	{
+		device->deleteSync(m_fences[i].fence);
+	}
+	m_fences.clear();
+
+	if (m_buffer)
+	{
+		device->bindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+		device->unmapBuffer(GL_COPY_READ_BUFFER);
+		device->bindBuffer(GL_COPY_READ_BUFFER, 0);
+
+		device->deleteBuffer(m_buffer);
+	}
+}
+
+void UploadRingBuffer::upload(unsigned int destinationBuffer, size_t destinationOffset, const void* data, size_t size)
+{
+	m_frameStats.bytesUploaded += size;
+	m_frameStats.uploadCount++;
+
+	// Uploads that could never fit in the ring go straight to the destination buffer
+	if (!m_mappedData || size > m_size)
+	{
+		uploadFallback(destinationBuffer, destinationOffset, data, size);
+		return;
+	}
+
+	size_t offset = stage(data, size);
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->countMappedUpload(size);
+
+	device->bindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, destinationBuffer);
+	device->copyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, destinationOffset, size);
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	device->bindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void UploadRingBuffer::uploadTexture(unsigned int texture, int x, int y, int width, int height, const void* data)
+{
+	size_t size = (size_t)width * height * 4;
+	m_frameStats.bytesUploaded += size;
+	m_frameStats.uploadCount++;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	if (!m_mappedData || size > m_size)
+	{
+		device->updateTexture(texture, x, y, width, height, data);
+		return;
+	}
+
+	// The ring is bound as the pixel unpack buffer, so the texture is filled from it on the GPU and the data is an offset into it
+	size_t offset = stage(data, size);
+
+	device->bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	device->updateTexture(texture, x, y, width, height, reinterpret_cast<const void*>(offset));
+	device->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRingBuffer::endFrame()
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	// Fence everything written this frame, so it isn't overwritten until the GPU has copied it
+	if (m_mappedData && m_head != m_fencedHead)
+	{
+		FrameFence frameFence;
+		frameFence.fence = device->fenceSync();
+		frameFence.end = m_head;
+		m_fences.push_back(frameFence);
+
+		m_fencedHead = m_head;
+	}
+
+	// Release the parts of the ring the GPU has finished with, without waiting
+	while (!m_fences.empty())
+	{
+		GLenum result = device->clientWaitSync(m_fences.front().fence, false, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+
+		m_tail = m_fences.front().end;
+		device->deleteSync(m_fences.front().fence);
+		m_fences.pop_front();
+	}
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_lastFrameStats = m_frameStats;
+	m_frameStats = UploadStats();
+}
+
+bool UploadRingBuffer::isPersistent() const
+{
+	return m_mappedData != nullptr;
+}
+
+UploadStats UploadRingBuffer::getLastFrameStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_lastFrameStats;
+}
+
+size_t UploadRingBuffer::stage(const void* data, size_t size)
+{
+	// Uploads are never split, so skip to the start of the ring if this one doesn't fit before the end
+	size_t offset = m_head % m_size;
+	if (offset + size > m_size)
+	{
+		m_head += m_size - offset;
+		offset = 0;
+	}
+
+	waitForSpace(size);
+
+	// The buffer is coherent, so the write is visible to the GPU without flushing
+	memcpy_s(m_mappedData + offset, m_size - offset, data, size);
+	m_head += size;
+
+	return offset;
+}
+
+void UploadRingBuffer::waitForSpace(size_t size)
+{
+	// The upload would overwrite data the GPU might not have copied yet
+	if (m_head + size <= m_tail + m_size) return;
+
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+
+	// The data this frame has written so far needs a fence too, in case the upload has to wait on it
+	if (m_head != m_fencedHead)
+	{
+		FrameFence frameFence;
+		frameFence.fence = device->fenceSync();
+		frameFence.end = m_head;
+		m_fences.push_back(frameFence);
+
+		m_fencedHead = m_head;
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	bool hasStalled = false;
+
+	while (m_head + size > m_tail + m_size && !m_fences.empty())
+	{
+		GLenum result = device->clientWaitSync(m_fences.front().fence, true, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			hasStalled = true;
+			result = device->clientWaitSync(m_fences.front().fence, true, GL_TIMEOUT_IGNORED);
+		}
+
+		if (result == GL_WAIT_FAILED)
+			Output::error("ERROR: Failed to wait for the upload ring buffer's fence");
+
+		m_tail = m_fences.front().end;
+		device->deleteSync(m_fences.front().fence);
+		m_fences.pop_front();
+	}
+
+	if (hasStalled)
+	{
+		std::chrono::duration<float, std::milli> stallTime = std::chrono::high_resolution_clock::now() - startTime;
+		m_frameStats.stallCount++;
+		m_frameStats.stallTime += stallTime.count();
+	}
+}
+
+void UploadRingBuffer::uploadFallback(unsigned int destinationBuffer, size_t destinationOffset, const void* data, size_t size)
+{
+	GraphicsDevice* device = GraphicsDevice::getInstance();
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, destinationBuffer);
+	device->bufferSubData(GL_COPY_WRITE_BUFFER, destinationOffset, size, data);
+	device->bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <deque>
+#include <mutex>
+
+#define UPLOAD_RING_BUFFER_SIZE (4 * 1024 * 1024) // The size of the ring buffer used to stream data to the GPU in bytes
+
+// Upload stats for a single frame
+struct UploadStats
+{
+	UploadStats() : bytesUploaded(0), uploadCount(0), stallCount(0), stallTime(0.0f) {}
+
+	size_t bytesUploaded;
+	size_t uploadCount;
+	size_t stallCount; // The number of times an upload had to wait for the GPU to finish with the ring buffer
+	float stallTime; // The time spent waiting in milliseconds
+};
+
+// Streams data into GPU buffers through a persistently mapped ring buffer. Data is written straight into the mapped memory
+// and then copied into the destination buffer on the GPU, so the upload never waits on the destination buffer being in use.
+// Each frame's part of the ring is fenced, and is only written to again once the GPU has finished copying out of it.
+// Falls back to glBufferSubData when persistent mapping (ARB_buffer_storage) isn't supported.
+// Textures are streamed the same way, with the ring bound as the pixel unpack buffer.
+class UploadRingBuffer
+{
+public:
+	UploadRingBuffer(size_t size = UPLOAD_RING_BUFFER_SIZE);
+	~UploadRingBuffer();
+
+	void upload(unsigned int destinationBuffer, size_t destinationOffset, const void* data, size_t size);
+
+	// Fills part of a texture with BGRA data, staged through the ring as a pixel buffer object
+	void uploadTexture(unsigned int texture, int x, int y, int width, int height, const void* data);
+
+	void endFrame();
+
+	bool isPersistent() const;
+	UploadStats getLastFrameStats() const;
+
+private:
+	struct FrameFence
+	{
+		GLsync fence;
+		size_t end; // The ring position up to which the frame wrote
+	};
+
+	size_t stage(const void* data, size_t size); // Copies the data into the ring and returns its offset in the buffer
+	void waitForSpace(size_t size);
+	void uploadFallback(unsigned int destinationBuffer, size_t destinationOffset, const void* data, size_t size);
+
+	unsigned int m_buffer;
+	unsigned char* m_mappedData;
+	size_t m_size;
+
+	// Positions in the ring only ever increase, and are wrapped by the ring's size when used as offsets
+	size_t m_head; // Where the next upload is written
+	size_t m_tail; // Everything before this has been consumed by the GPU
+	size_t m_fencedHead; // Where the last fence was placed
+
+	std::deque<FrameFence> m_fences;
+
+	UploadStats m_frameStats;
+	UploadStats m_lastFrameStats;
+	mutable std::mutex m_statsMutex; // The buffer is used on the render thread, but its stats can be read from anywhere
+};
@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "Window.h"
 
+#include "GLGraphicsDevice.h"
+
 Window* Window::m_instance = nullptr;
 
 void glMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const char* message, const void* userParam)
@@ -36,6 +38,10 @@ void glfwMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
 
 void glfwMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+	if (action == GLFW_PRESS)
+		Input::getInstance()->_pressMouseButton(button);
+	else if (action == GLFW_RELEASE)
+		Input::getInstance()->_releaseMouseButton(button);
 }
 
 Window::Window(int width, int height, const std::string& title)
@@ -59,6 +65,10 @@ Window::Window(int width, int height, const std::string& title)
 		exit(EXIT_FAILURE);
 	}
 
+	// Startup is measured from here until the first frame has been presented
+	m_startTime = glfwGetTime();
+	m_timeToFirstFrame = 0;
+
 	glfwSetErrorCallback(&glfwErrorCallback);
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -84,6 +94,7 @@ Window::Window(int width, int height, const std::string& title)
 
 	glfwSetKeyCallback(m_window, &glfwKeyCallback);
 	glfwSetCursorPosCallback(m_window, &glfwMousePositionCallback);
+	glfwSetMouseButtonCallback(m_window, &glfwMouseButtonCallback);
 	glfwSetFramebufferSizeCallback(m_window, &glfwFrameBufferResizeCallback);
 
 	// Vsync - 1 for on 0 for off
@@ -98,13 +109,26 @@ Window::Window(int width, int height, const std::string& title)
 	m_fpsFrameCount = 0;
 
 	m_input = new Input();
+	m_graphicsDevice = new GLGraphicsDevice();
+	m_renderQueue = new RenderQueue();
 	m_engine = new Engine(m_width, m_height);
+
+	Output::log("Engine startup took " + std::to_string((glfwGetTime() - m_startTime) * 1000.0) + " ms");
+
+	// Everything has been created, so the GL context is handed over to the render thread
+	m_renderQueue->start(m_window);
 }
 
 Window::~Window()
 {
 	m_instance = nullptr;
+
+	// Stop rendering before the engine's GL resources are deleted on this thread
+	m_renderQueue->stop();
+
 	delete m_engine;
+	delete m_renderQueue;
+	delete m_graphicsDevice;
 	delete m_input;
 
 	glfwDestroyWindow(m_window);
@@ -116,6 +140,11 @@ Window* Window::getInstance()
 	return m_instance;
 }
 
+float Window::getTimeToFirstFrame() const
+{
+	return m_timeToFirstFrame;
+}
+
 void Window::setTitle(const std::string& title)
 {
 	m_title = title;
@@ -132,8 +161,6 @@ void Window::resize(int width, int height)
 	m_width = width;
 	m_height = height;
 
-	glViewport(0, 0, width, height);
-
 	m_engine->onWindowResize(m_width, m_height);
 }
 
@@ -160,12 +187,20 @@ void Window::mainLoop()
 			m_fpsFrameCount = 0;
 		}
 
+		// The engine records the frame's render commands, which the render thread executes and presents while the next frame is simulated
 		m_engine->update(deltaTime);
 		m_input->update();
 
-		glfwSwapBuffers(m_window);
+		m_renderQueue->submitFrame();
 		glfwPollEvents();
 
+		// Track how long it took for the first complete frame to be presented
+		if (m_timeToFirstFrame == 0 && m_renderQueue->getPresentedFrameCount() > 0)
+		{
+			m_timeToFirstFrame = (float)((glfwGetTime() - m_startTime) * 1000.0);
+			Output::log("Time to first complete frame: " + std::to_string(m_timeToFirstFrame) + " ms");
+		}
+
 		m_prevTime = time;
 	}
 }
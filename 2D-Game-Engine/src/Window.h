@@ -3,7 +3,9 @@
 #include <GL/glew.h>
 
 #include "Engine.h"
+#include "GraphicsDevice.h"
 #include "Input.h"
+#include "RenderQueue.h"
 
 class Window
 {
@@ -14,6 +16,8 @@ public:
 	static Window* getInstance();
 
 	void setTitle(const std::string& title);
+
+	float getTimeToFirstFrame() const;
 	
 	void resize(int width, int height);
 	
@@ -25,6 +29,8 @@ private:
 	static Window* m_instance;
 
 	Input* m_input;
+	GraphicsDevice* m_graphicsDevice;
+	RenderQueue* m_renderQueue;
 	Engine* m_engine;
 
 	GLFWwindow* m_window;
@@ -36,6 +42,9 @@ private:
 
 	double m_prevTime;
 
+	double m_startTime;
+	float m_timeToFirstFrame;
+
 	float m_fpsAccumulator;
 	int m_fpsFrameCount;
 };